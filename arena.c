@@ -0,0 +1,99 @@
+/* ************************************************************************
+> File Name:     arena.c
+> Author:        ferdi
+> Created Time:  Sun 10 Mar 2024 03:26:11 PM CST
+> Description:
+ ************************************************************************/
+#include "rvcc.h"
+
+// bump pointer allocation, everything in an arena is freed at once
+// the chunks of an arena double from ARENA_MIN up to ARENA_CHUNK, so the
+// arena of a small function stays small
+#define ARENA_MIN (4 * 1024)
+#define ARENA_CHUNK (64 * 1024)
+#define ARENA_CLASSES 5     //chunk sizes ARENA_MIN << 0 .. 4
+
+struct ArenaChunk {
+    ArenaChunk* Next;
+    size_t Size;
+    char Data[];
+};
+
+//types, members and global objects, kept for the whole translation unit
+//one per thread, as the lexer threads make the types of string literals
+_Thread_local Arena GlobalArena;
+
+//chunks of freed arenas by size class, handed out again before malloc is asked
+static _Thread_local ArenaChunk* FreeChunks[ARENA_CLASSES];
+
+//size class of a chunk, -1 for a big block's own chunk
+static int sizeClass(size_t Size) {
+    for(int I = 0; I < ARENA_CLASSES; ++I) {
+        if(Size == (size_t)ARENA_MIN << I)
+            return I;
+    }
+    return -1;
+}
+
+static ArenaChunk* newChunk(size_t Size) {
+    int Class = sizeClass(Size);
+    if(Class >= 0 && FreeChunks[Class]) {
+        ArenaChunk* C = FreeChunks[Class];
+        FreeChunks[Class] = C->Next;
+        memset(C->Data, 0, Size);
+        return C;
+    }
+    ArenaChunk* C = calloc(1, sizeof(ArenaChunk) + Size);
+    C->Size = Size;
+    return C;
+}
+
+//zero filled, 8 byte aligned
+void* arenaAlloc(Arena* A, size_t Size) {
+    Size = (Size + 7) & ~(size_t)7;
+
+    if(A->Chunks && A->Used + Size <= A->Chunks->Size) {
+        void* P = A->Chunks->Data + A->Used;
+        A->Used += Size;
+        return P;
+    }
+
+    //a big block gets a chunk of its own behind the current one
+    if(Size > ARENA_CHUNK / 4) {
+        ArenaChunk* C = newChunk(Size);
+        if(A->Chunks) {
+            C->Next = A->Chunks->Next;
+            A->Chunks->Next = C;
+        }else {
+            A->Chunks = C;
+            A->Used = Size;
+        }
+        return C->Data;
+    }
+
+    size_t ChunkSize = A->Chunks ? MIN(A->Chunks->Size * 2, ARENA_CHUNK) : ARENA_MIN;
+    while(ChunkSize < Size)
+        ChunkSize *= 2;
+    ArenaChunk* C = newChunk(ChunkSize);
+    C->Next = A->Chunks;
+    A->Chunks = C;
+    A->Used = Size;
+    return C->Data;
+}
+
+void arenaFree(Arena* A) {
+    ArenaChunk* C = A->Chunks;
+    while(C) {
+        ArenaChunk* Next = C->Next;
+        int Class = sizeClass(C->Size);
+        if(Class >= 0) {
+            C->Next = FreeChunks[Class];
+            FreeChunks[Class] = C;
+        }else {
+            free(C);
+        }
+        C = Next;
+    }
+    A->Chunks = NULL;
+    A->Used = 0;
+}
@@ -212,7 +212,7 @@ static void genAddr(Node *Nd) {
 // 生成表达式
 static void genExpr(Node *Nd) {
   
-   printLn("  .loc 1 %d", Nd->Tok->LineNo);
+   printLn("  .loc %d %d", Nd->Tok->File->FileNo, Nd->Tok->LineNo);
   // 生成各个根节点
   switch (Nd->Kind) {
   // 加载数字到a0
@@ -442,7 +442,7 @@ static void genExpr(Node *Nd) {
 
 // 生成语句
 static void genStmt(Node *Nd) {
-  printLn("  .loc 1 %d", Nd->Tok->LineNo);
+  printLn("  .loc %d %d", Nd->Tok->File->FileNo, Nd->Tok->LineNo);
   switch (Nd->Kind) {
   // 生成if语句
   case ND_IF: {
@@ -524,8 +524,8 @@ static void genStmt(Node *Nd) {
     genExpr(Nd->Cond);
 
     printLn("  # 遍历跳转到值等于a0的case标签");
-    for (Node *N = Nd->CaseNext; N; N = N->CaseNext) {
-      printLn("  li t0, %ld", N->Val);
+    for (Node *N = Nd->Cases; N; N = N->CaseNext) {
+      printLn("  li t0, %ld", N->CaseVal);
       printLn("  beq a0, t0, %s", N->Label);
     }
 
@@ -542,7 +542,7 @@ static void genStmt(Node *Nd) {
     printLn("%s:", Nd->BrkLabel);
     return;
   case ND_CASE:
-    printLn("# case标签，值为%ld", Nd->Val);
+    printLn("# case标签，值为%ld", Nd->CaseVal);
     printLn("%s:", Nd->Label);
     genStmt(Nd->LHS);
     return; 
@@ -572,23 +572,18 @@ static void genStmt(Node *Nd) {
 }
 
 // 根据变量的链表计算出偏移量
-static void assignLVarOffsets(Obj *Prog) {
-   for (Obj *Fn = Prog; Fn; Fn = Fn->Next) {
-    if(!Fn->IsFunction)
-        continue;
-    int Offset = 0;
-    // 读取所有变量
-    for (Obj *Var = Fn->Locals; Var; Var = Var->Next) {
-      // 每个变量分配8字节
-      Offset += Var->Ty->Size;
-      // 为每个变量赋一个偏移量，或者说是栈中地址
-      Offset = alignTo(Offset, Var->Ty->Align);
-      Var->Offset = -Offset;
-    }
-    // 将栈对齐到16字节
-    Fn->StackSize = alignTo(Offset, 16);
+static void assignLVarOffsets(Obj *Fn) {
+  int Offset = 0;
+  // 读取所有变量
+  for (Obj *Var = Fn->Locals; Var; Var = Var->Next) {
+    // 每个变量分配8字节
+    Offset += Var->Ty->Size;
+    // 为每个变量赋一个偏移量，或者说是栈中地址
+    Offset = alignTo(Offset, Var->Ty->Align);
+    Var->Offset = -Offset;
   }
- 
+  // 将栈对齐到16字节
+  Fn->StackSize = alignTo(Offset, 16);
 }
 
 unsigned int simpleLog2(unsigned int Align) {
@@ -602,20 +597,93 @@ unsigned int simpleLog2(unsigned int Align) {
     return count;
 }
 
+// 字符串字面量放入只读段
+static void emitLiteral(Obj* Var) {
+  char* Str = Var->InitData;
+  int Len = Var->Ty->Size - 1;
+
+  // 内部含'\0'的无法放入按'\0'切分的可合并段
+  if(memchr(Str, '\0', Len)) {
+    printLn("\n  # 字符串字面量%s", Var->Name);
+    printLn("  .section .rodata");
+    printLn("%s:", Var->Name);
+    for(int I = 0; I <= Len; ++I)
+      printLn("  .byte %d", Str[I]);
+    return;
+  }
+
+  // 可合并的字符串段，链接器会合并不同目标文件中相同的字符串
+  char* Buf = calloc(1, Len * 4 + 1);
+  int Pos = 0;
+  for(int I = 0; I < Len; ++I) {
+    unsigned char C = Str[I];
+    if(C == '"' || C == '\\')
+      Pos += sprintf(Buf + Pos, "\\%c", C);
+    else if(isprint(C))
+      Buf[Pos++] = C;
+    else
+      Pos += sprintf(Buf + Pos, "\\%03o", C);
+  }
+  printLn("\n  # 字符串字面量%s", Var->Name);
+  printLn("  .section .rodata.str1.1,\"aMS\",@progbits,1");
+  printLn("%s:", Var->Name);
+  printLn("  .string \"%s\"", Buf);
+  free(Buf);
+}
+
+// 输出[Pos, End)的数据：长的零串用.zero，其余每行至多16个.byte
+static void emitBytes(char* Data, int Pos, int End) {
+  while (Pos < End) {
+    int Z = Pos;
+    while (Z < End && !Data[Z])
+      Z++;
+    if (Z - Pos >= 16) {
+      printLn("  .zero %d", Z - Pos);
+      Pos = Z;
+      continue;
+    }
+
+    // 大表逐字节调用printf太慢，这里手动拼接一行
+    char Line[16 * 5 + 16] = "  .byte ";
+    int Len = strlen(Line);
+    for (int I = 0; I < 16 && Pos < End; I++, Pos++) {
+      if (I)
+        Line[Len++] = ',';
+      int C = Data[Pos];
+      if (C < 0) {
+        Line[Len++] = '-';
+        C = -C;
+      }
+      if (C >= 100)
+        Line[Len++] = '0' + C / 100;
+      if (C >= 10)
+        Line[Len++] = '0' + C / 10 % 10;
+      Line[Len++] = '0' + C % 10;
+    }
+    Line[Len] = '\0';
+    printLn("%s", Line);
+  }
+}
+
 static void emitData(Obj* Prog) {
 
   for (Obj *Var = Prog; Var; Var = Var->Next) {
      if(Var->IsFunction || !Var->IsDefinition)
          continue;
+     if(Var->IsLiteral) {
+         emitLiteral(Var);
+         continue;
+     }
      printLn("\n  # 全局段%s", Var->Name);
      printLn("  .globl %s", Var->Name);
+     if (!Var->Ty->Align)
+       error("Align can not be 0!");
+     // 先切换段再对齐，字符串字面量之后当前段是只读段
      if(Var->InitData){
-         printLn("  # 对齐全局变量");
-         if (!Var->Ty->Align)
-           error("Align can not be 0!");
-         printLn("  .align %d", simpleLog2(Var->Ty->Align));
          printLn("\n  # 数据段标签");
          printLn("  .data");
+         printLn("  # 对齐全局变量");
+         printLn("  .align %d", simpleLog2(Var->Ty->Align));
          printLn("%s:", Var->Name);
          Relocation* Rel = Var->Rel;
          int Pos = 0;
@@ -626,98 +694,116 @@ static void emitData(Obj* Prog) {
                  Rel = Rel->Next;
                  Pos += 8;
              } else {
-                 char C = Var->InitData[Pos++];
-                 if(isprint(C)) {
-                     printLn("  .byte %d\t# 字符：%c", C, C);
-                 } else {
-                     printLn("  .byte %d", C);
-                 }
+                 int End = Rel ? Rel->Offset : Var->Ty->Size;
+                 emitBytes(Var->InitData, Pos, End);
+                 Pos = End;
              }
          }
          continue;
      } else {
         printLn("  # 未初始化的全局变量");
         printLn("  .bss");
+        printLn("  # 对齐全局变量");
+        printLn("  .align %d", simpleLog2(Var->Ty->Align));
         printLn("%s:", Var->Name);
         printLn("  # 全局变量零填充%d字节", Var->Ty->Size);
         printLn("  .zero %d", Var->Ty->Size);
     }
   }
 }
-// 代码生成入口函数，包含代码块的基础信息
-void emitText(Obj *Prog) {
-
-  for (Obj *Fn = Prog; Fn; Fn = Fn->Next) {
-    if(!Fn->IsFunction || !Fn->IsDefinition)
-        continue;
-      if(Fn->IsStatic) {
-          printLn("\n  # 定义局部%s函数", Fn->Name);
-          printLn("  .local %s", Fn->Name);
-      } else {
-          printLn("\n  # 定义全局%s函数", Fn->Name);
-          printLn("  .globl %s", Fn->Name);
-      }
-      printLn("  .text");
-      printLn("# =====%s段开始===============", Fn->Name);
-      printLn("# %s段标签", Fn->Name);
-      printLn("%s:", Fn->Name);
-      CurrentFn = Fn;
-
-      // 栈布局
-      //-------------------------------// sp
-      //              ra
-      //-------------------------------// ra = sp-8
-      //              fp
-      //-------------------------------// fp = sp-16
-      //             变量
-      //-------------------------------// sp = sp-16-StackSize
-      //           表达式计算
-      //-------------------------------//
-      // Prologue, 前言
-      // 将fp压入栈中，保存fp的值
-      printLn("  # 将ra寄存器压栈,保存ra的值");
-      printLn("  addi sp, sp, -16");
-      printLn("  sd ra, 8(sp)");
-      printLn("  # 将fp压栈，fp属于“被调用者保存”的寄存器，需要恢复原值");
-      printLn("  sd fp, 0(sp)");
-      // 将sp写入fp
-      printLn("  # 将sp的值写入fp");
-      printLn("  mv fp, sp");
-
-      // 偏移量为实际变量所用的栈大小
-      printLn("  # sp腾出StackSize大小的栈空间");
-      printLn("  addi sp, sp, -%d", Fn->StackSize);
-
-      int I = 0;
-      for(Obj* Var = Fn->Param; Var; Var = Var->Next){
-            storeGeneral(I++, Var->Offset, Var->Ty->Size);
-      }
-
-      // 生成语句链表的代码
-      printLn("\n# =====程序主体===============");
-      genStmt(Fn->Body);
-      assert(Depth == 0);
-      printLn("# =====%s段结束===============", Fn->Name);
-      printLn("# return段标签");
-      printLn(".L.return.%s:", Fn->Name);
-      // 将fp的值改写回sp
-      printLn("  # 将fp的值写回sp");
-      printLn("  mv sp, fp");
-      // 将最早fp保存的值弹栈，恢复fp。
-      printLn("  # 将最早fp保存的值弹栈，恢复fp和sp");
-      printLn("  ld fp, 0(sp)");
-      // 将ra寄存器弹栈,恢复ra的值
-      printLn("  # 将ra寄存器弹栈,恢复ra的值");
-      printLn("  ld ra, 8(sp)");
-      printLn("  addi sp, sp, 16");
-      // 返回
-      printLn("  # 返回a0值给系统调用");
-      printLn("  ret");
+// 生成一个函数的代码
+static void emitFunction(Obj *Fn) {
+  if(Fn->IsStatic) {
+      printLn("\n  # 定义局部%s函数", Fn->Name);
+      printLn("  .local %s", Fn->Name);
+  } else {
+      printLn("\n  # 定义全局%s函数", Fn->Name);
+      printLn("  .globl %s", Fn->Name);
   }
+  printLn("  .text");
+  printLn("# =====%s段开始===============", Fn->Name);
+  printLn("# %s段标签", Fn->Name);
+  printLn("%s:", Fn->Name);
+  CurrentFn = Fn;
+
+  // 栈布局
+  //-------------------------------// sp
+  //              ra
+  //-------------------------------// ra = sp-8
+  //              fp
+  //-------------------------------// fp = sp-16
+  //             变量
+  //-------------------------------// sp = sp-16-StackSize
+  //           表达式计算
+  //-------------------------------//
+  // Prologue, 前言
+  // 将fp压入栈中，保存fp的值
+  printLn("  # 将ra寄存器压栈,保存ra的值");
+  printLn("  addi sp, sp, -16");
+  printLn("  sd ra, 8(sp)");
+  printLn("  # 将fp压栈，fp属于“被调用者保存”的寄存器，需要恢复原值");
+  printLn("  sd fp, 0(sp)");
+  // 将sp写入fp
+  printLn("  # 将sp的值写入fp");
+  printLn("  mv fp, sp");
+
+  // 偏移量为实际变量所用的栈大小
+  printLn("  # sp腾出StackSize大小的栈空间");
+  printLn("  addi sp, sp, -%d", Fn->StackSize);
+
+  int I = 0;
+  for(Obj* Var = Fn->Param; Var; Var = Var->Next){
+        storeGeneral(I++, Var->Offset, Var->Ty->Size);
+  }
+
+  // 生成语句链表的代码
+  printLn("\n# =====程序主体===============");
+  genStmt(Fn->Body);
+  assert(Depth == 0);
+  printLn("# =====%s段结束===============", Fn->Name);
+  printLn("# return段标签");
+  printLn(".L.return.%s:", Fn->Name);
+  // 将fp的值改写回sp
+  printLn("  # 将fp的值写回sp");
+  printLn("  mv sp, fp");
+  // 将最早fp保存的值弹栈，恢复fp。
+  printLn("  # 将最早fp保存的值弹栈，恢复fp和sp");
+  printLn("  ld fp, 0(sp)");
+  // 将ra寄存器弹栈,恢复ra的值
+  printLn("  # 将ra寄存器弹栈,恢复ra的值");
+  printLn("  ld ra, 8(sp)");
+  printLn("  addi sp, sp, 16");
+  // 返回
+  printLn("  # 返回a0值给系统调用");
+  printLn("  ret");
+
+  // 函数体的节点和局部变量不再使用，释放
+  arenaFree(Fn->Arena);
+  free(Fn->Arena);
+  Fn->Arena = NULL;
+  Fn->Body = NULL;
+  Fn->Param = Fn->Locals = NULL;
+}
+
+// 输出新读入的文件的.file，头文件是在预处理到它时才读入的
+static void emitFiles(void) {
+  static int Emitted;
+  File** Files = getInputFiles();
+  for(; Files[Emitted]; ++Emitted)
+    printLn(".file %d \"%s\"", Files[Emitted]->FileNo, Files[Emitted]->Name);
 }
+
+// 函数解析完即生成代码，随后释放其节点
+void codegenFunction(Obj *Fn, FILE* Out) {
+    OutputFile = Out;
+    emitFiles();
+    assignLVarOffsets(Fn);
+    emitFunction(Fn);
+}
+
+// 函数都已生成，最后输出全局变量的数据
 void codegen(Obj *Prog, FILE* Out) {
     OutputFile = Out;
-    assignLVarOffsets(Prog);
+    emitFiles();
     emitData(Prog);
-    emitText(Prog);
 }
@@ -13,8 +13,14 @@ static char* OptO;
 //Input file Path
 static char* InputPath;
 
+//threads used to tokenize large inputs
+static int OptLexThreads = 1;
+
+//print the node and typing counts to stderr
+static bool OptStats;
+
 static void usage(int Status) {
-    fprintf(stderr, "rvcc [ -o <path> ] <file>\n");
+    fprintf(stderr, "rvcc [ -o <path> ] [ -I <dir> ] [ --lex-threads <n> ] [ --stats ] <file>\n");
     exit(Status);
 }
 
@@ -31,6 +37,36 @@ static void parseArgs(int Argc, char** Argv) {
            continue;
         }
        
+        // -I XXX
+        if(!strcmp(Argv[I], "-I")) {
+           if(!Argv[++I])
+               usage(1);
+           addIncludePath(Argv[I]);
+           continue;
+        }
+
+        // -IXXX
+        if(!strncmp(Argv[I], "-I", 2)) {
+           addIncludePath(Argv[I] + 2);
+           continue;
+        }
+
+        // --lex-threads N
+        if(!strcmp(Argv[I], "--lex-threads")) {
+           if(!Argv[++I])
+               usage(1);
+           OptLexThreads = atoi(Argv[I]);
+           if(OptLexThreads < 1)
+               error("invalid thread count: %s", Argv[I]);
+           continue;
+        }
+
+        // --stats
+        if(!strcmp(Argv[I], "--stats")) {
+           OptStats = true;
+           continue;
+        }
+
         // -oXXX
         if(Argv[I][0] == '-' && Argv[I][1] != '\0') {
             error("unknown argument: %s", Argv[I]);
@@ -42,25 +78,51 @@ static void parseArgs(int Argc, char** Argv) {
         error("no Input File");
 }
 
+//the output is written to a temp file next to it and renamed once it is
+//complete, so an error exit never leaves a truncated file behind
+static char* TmpOutPath;
+
+static void removeTmpOut(void) {
+    if(TmpOutPath)
+        unlink(TmpOutPath);
+}
+
 static FILE* openFile(char* Path) {
     if(!Path || strcmp(Path, "-") == 0)
         return stdout;
 
-    FILE* Out = fopen(Path, "w");
-    if(!Out) {
+    TmpOutPath = format("%s.XXXXXX", Path);
+    int Fd = mkstemp(TmpOutPath);
+    if(Fd == -1) {
         error("cannot open output file: %s: %s", Path, strerror(errno));
     }
-    return Out;
+    atexit(removeTmpOut);
+    //mkstemp makes it 0600, give it the mode a new file would get
+    mode_t Mask = umask(0);
+    umask(Mask);
+    fchmod(Fd, 0666 & ~Mask);
+    return fdopen(Fd, "w");
+}
+
+static void closeFile(FILE* Out, char* Path) {
+    if(!TmpOutPath)
+        return;
+    if(fclose(Out) != 0 || rename(TmpOutPath, Path) != 0)
+        error("cannot write output file: %s: %s", Path, strerror(errno));
+    TmpOutPath = NULL;
 }
 
 int main(int Argc, const char** Argv) {
 
     parseArgs(Argc, Argv); 
-    Token* Tok = tokenizeFile(InputPath);
-    Obj* Prog = parse(Tok); 
+    Token* Tok = tokenizeFile(InputPath, OptLexThreads);
     FILE* Out = openFile(OptO);
-    fprintf(Out, ".file 1 \"%s\"\n", InputPath);
+    //functions are written out while parsing, the data at the end
+    Obj* Prog = parse(Tok, Out); 
     codegen(Prog, Out);
+    closeFile(Out, OptO);
+    if(OptStats)
+        fprintf(stderr, "nodes: %ld, typed: %ld\n", (long)NodeCnt, (long)TypeVisits);
     
     return 0;
 }
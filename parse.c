@@ -13,6 +13,9 @@ static Node* Gotos;
 static Node* Labels;
 
 static Obj* CurrentFunc;
+
+//arena of the function being parsed, NULL outside of functions
+static Arena* FuncArena;
 static Node* CurrentSwitch;
 
 static char* BrkLabel;
@@ -24,9 +27,11 @@ typedef struct TagScope TagScope;
 
 // struct union enum TagScope
 struct TagScope {
-    TagScope* Next;
-    char* Name;
+    TagScope* Next;     //next declared in the same scope
+    TagScope* Shadow;   //what the tag meant before this one
+    char* Name;     //interned
     Type* Ty;
+    int Depth;      //of the scope declaring it
 };
 
 static Node* structRef(Node* LHS, Token* Tok); 
@@ -46,6 +51,13 @@ struct Initializer {
 
     //for nest Initializer
     Initializer** Children; //Children probably Array which contain Initializer pointer , there is use the pointer which point at Initializer pointer
+    //arrays make children on first use, the elements from ChildCnt on are zero
+    int ChildCnt;
+    int ChildCap;
+    //a leading run of plain numbers in an integer array, kept as the bytes
+    //of its first DataCnt elements
+    char* Data;
+    int DataCnt;
     //for unest one
     Node* Expr;
     bool IsFlexible;
@@ -66,8 +78,9 @@ struct Scope {
 };
 
 struct VarScope {
-    VarScope* Next;
-    char* Name;
+    VarScope* Next;     //next declared in the same scope
+    VarScope* Shadow;   //what the name meant before this one
+    char* Name;     //interned
     Obj* Vars;
     Type* Typedef;
 
@@ -131,19 +144,11 @@ typedef struct {
 
 // expr = assign (',' expr)?
 // assign = conditional (assignOp assign)?
-// conditional = logOr ("?" expr ":" conditional)?
-// logOr = logAnd ("||" logAnd)*
-// logAnd = bitOr ("&&" bitOr)*
-// bitOr = bitXor ("|" bitXor)*
-// bitXor = bitAnd ("^" bitAnd)*
-// bitAnd = equality ("&" equality)*
+// conditional = binary ("?" expr ":" conditional)?
 // assignOp = "=" | "+=" | "*=" | "-=" | "/=" | "%=" | "^=" | "|=" | "&=" | "<<=" | ">>="
 
-// equality = relational ("==" relational | "!=" relational)*
-// relational = shift ("<" shift | "<=" shift | ">" shift | ">=" shift)*
-// shift = add (">>" add | "<<" add)*
-// add = mul ("+" mul | "-" mul)*
-// mul = cast ("*" cast | "/" cast | "%" cast)*
+// binary = cast (binaryOp cast)*, by the precedence in BinaryOps, loosest first:
+//          "||"  "&&"  "|"  "^"  "&"  "==" "!="  "<" "<=" ">" ">="  "<<" ">>"  "+" "-"  "*" "/" "%"
 // cast = "(" typename ")" cast | unary
 // unary = ( "+" | "-" | "*" | "&" | "!" | "~") cast |  postfix
 // postfix = primary ("[" expr "]" | "." indent | "->" indent)* || "++" || "--"
@@ -168,19 +173,16 @@ typedef struct {
 // preorder
 
 static Node* compoundStmt(Token** Rest, Token* Tok);
-static Node* declaration(Token** Rest, Token* Tok, Type* BaseTy);
+static Node* declaration(Token** Rest, Token* Tok, Type* BaseTy, Type* Ty);
 static Node* stmt(Token** Rest, Token* Tok);
 static void initializer2(Token** Rest, Token* Tok, Initializer* Init); 
+static void writeBuf(char* Buf, uint64_t Val, int Sz);
+static int64_t readBuf(char* Buf, int Sz);
 static Node* exprStmt(Token** Rest, Token* Tok);
 static Node* expr(Token** Rest, Token* Tok);
 static Node* assign(Token** Rest, Token* Tok);
 static Node* conditional(Token** Rest, Token* Tok);
-static Node* equality(Token** Rest, Token* Tok);
-static Node* relational(Token** Rest, Token* Tok);
-
-static Node* shift(Token** Rest, Token* Tok);
-static Node* add(Token** Rest, Token* Tok);
-static Node* mul(Token** Rest, Token* Tok);
+static Node* binary(Token** Rest, Token* Tok, int MinPrec);
 static Node* cast(Token** Rest, Token* Tok);
 static Node* primary(Token** Rest, Token* Tok);
 static Node* postfix(Token** Rest, Token* Tok);
@@ -191,73 +193,138 @@ static Node* LVarInitializer(Token** Rest, Token* Tok, Obj* Var);
 static void GVarInitializer(Token** Rest, Token* Tok, Obj* Var);
 
 static int64_t eval2(Node* Nd, char** Label); 
-static Node* logOr(Token** Rest, Token* Tok); 
 static int64_t evalRVal(Node* Nd, char** Label);
-static Node* logAnd(Token** Rest, Token* Tok); 
-static Node* bitOr(Token** Rest, Token* Tok); 
-static Node* bitXor(Token** Rest, Token* Tok); 
-static Node* bitAnd(Token** Rest, Token* Tok); 
-static int64_t constExpr(Token** Rest, Token* Tok);
 static int64_t eval(Node* Nd);
 static Scope *Scp = &(Scope) {};
-static Token* globalVariable(Token* Tok, Type* BaseTy, VarAttr* Attr); 
-static bool isFunction(Token* Tok); 
-static Token* function(Token* Tok, Type* BaseTy, VarAttr* Attr); 
+static Token* globalVariable(Token* Tok, Type* BaseTy, Type* Ty, VarAttr* Attr); 
+static Token* function(Token* Tok, Type* Ty, VarAttr* Attr); 
+static Obj* declareFunc(Type* Ty, bool IsStatic);
+static bool isFuncDecl(Type* Ty, Token* Tok);
+
+// every name visible maps to its innermost VarScope and TagScope, the ones
+// they hide are chained by Shadow, so a lookup does not depend on the scope depth
+typedef struct {
+    char* Name;     //interned
+    VarScope* Var;
+    TagScope* Tag;
+} SymEntry;
+
+//how many scopes Scp is inside
+static int ScopeDepth;
+
+static SymEntry* SymTable;
+static int SymCap;
+static int SymCnt;
+
+//interned names hash by address
+static uint32_t nameHash(char* Name) {
+    return (uint32_t)((uintptr_t)Name >> 4) * 2654435761u;
+}
+
+static SymEntry* findSym(char* Name) {
+    uint32_t I = nameHash(Name) & (SymCap - 1);
+    while(SymTable[I].Name && SymTable[I].Name != Name)
+        I = (I + 1) & (SymCap - 1);
+    return &SymTable[I];
+}
+
+//entry of Name, added if missing
+static SymEntry* symEntry(char* Name) {
+    // keep the load factor under 1/2
+    if(SymCnt * 2 >= SymCap) {
+        SymEntry* Old = SymTable;
+        int OldCap = SymCap;
+        SymCap = SymCap ? SymCap * 2 : 1024;
+        SymTable = calloc(SymCap, sizeof(SymEntry));
+        for(int I = 0; I < OldCap; ++I) {
+            if(Old[I].Name)
+                *findSym(Old[I].Name) = Old[I];
+        }
+        free(Old);
+    }
+
+    SymEntry* E = findSym(Name);
+    if(!E->Name) {
+        E->Name = Name;
+        ++SymCnt;
+    }
+    return E;
+}
+
+//nodes, scopes and initializers live as long as their function
+static void* parseAlloc(size_t Size) {
+    return arenaAlloc(FuncArena ? FuncArena : &GlobalArena, Size);
+}
 
 static void enterScope(void) {
-    Scope* S = calloc(1, sizeof(Scope));
+    Scope* S = parseAlloc(sizeof(Scope));
     S->Next = Scp;
     Scp = S;
+    ++ScopeDepth;
 }
 
+//unhide what the names declared in the scope were hiding
 static void leaveScope(void) {
+    for(VarScope* S = Scp->Vars; S; S = S->Next)
+        findSym(S->Name)->Var = S->Shadow;
+    for(TagScope* S = Scp->Tags; S; S = S->Next)
+        findSym(S->Name)->Tag = S->Shadow;
     Scp = Scp->Next;
+    --ScopeDepth;
+}
+
+static TagScope* findTagScope(Token* Tok) {
+    if(!SymCap)
+        return NULL;
+    return findSym(Tok->Ident)->Tag;
 }
 
 static Type* findTag(Token* Tok) {
-    for(Scope* S = Scp; S; S = S->Next) 
-        for(TagScope* S2 = S->Tags; S2; S2 = S2->Next)
-            if(equal(Tok, S2->Name))
-                return S2->Ty;
-    return NULL;
+    TagScope* S = findTagScope(Tok);
+    return S ? S->Ty : NULL;
 }
 
-static void* pushTagScope(Token* Tok, Type* Ty) {
-    TagScope* S = calloc(1, sizeof(TagScope));
+static void pushTagScope(Token* Tok, Type* Ty) {
+    TagScope* S = parseAlloc(sizeof(TagScope));
     S->Ty = Ty;
-    S->Name = strndup(Tok->Pos, Tok->Len);
+    S->Name = Tok->Ident;
+    S->Depth = ScopeDepth;
     S->Next = Scp->Tags;
     Scp->Tags = S; 
+
+    SymEntry* E = symEntry(S->Name);
+    S->Shadow = E->Tag;
+    E->Tag = S;
 }
 
 static VarScope* findVar(Token* Tok) {
-    for(Scope* S = Scp; S; S = S->Next) 
-        for(VarScope* S2 = S->Vars; S2; S2 = S2->Next)
-            if(equal(Tok, S2->Name))
-                return S2;
-    return NULL;
+    if(!SymCap)
+        return NULL;
+    return findSym(Tok->Ident)->Var;
 }
 
 static VarScope* pushScope(char* Name) {
-    VarScope* S = calloc(1, sizeof(VarScope));
+    VarScope* S = parseAlloc(sizeof(VarScope));
     S->Name = Name;
     S->Next = Scp->Vars;
     Scp->Vars = S; 
+
+    SymEntry* E = symEntry(Name);
+    S->Shadow = E->Var;
+    E->Var = S;
     return S;
 }
 
 static Initializer* newInitializer(Type* Ty, bool IsFlexible) {
-    Initializer* Init = calloc(1, sizeof(Initializer));
+    Initializer* Init = parseAlloc(sizeof(Initializer));
     Init->Ty = Ty;
 
     if(Ty->typeKind == TypeSTRUCT || Ty->typeKind == TypeUNION) {
-        int Len = 0;
-        for(Member* Mem = Ty->Mem; Mem; Mem = Mem->Next)
-            ++Len;
-        Init->Children = calloc(Len, sizeof(Initializer*));
-        for(Member* Mem = Ty->Mem; Mem; Mem = Mem->Next) {
+        Init->Children = parseAlloc(sizeof(Initializer*) * Ty->MemCnt);
+        for(int I = 0; I < Ty->MemCnt; ++I) {
+            Member* Mem = Ty->Mems[I];
             if(IsFlexible && Ty->IsFlexible && !Mem->Next){
-                Initializer* Child = calloc(1, sizeof(Initializer));
+                Initializer* Child = parseAlloc(sizeof(Initializer));
                 Child->Ty = Mem->Ty;
                 Child->IsFlexible = true;
                 Init->Children[Mem->Idx] = Child;
@@ -272,16 +339,61 @@ static Initializer* newInitializer(Type* Ty, bool IsFlexible) {
             Init->IsFlexible = true;
             return Init;
         }
-        Init->Children = calloc(Ty->ArrayLen, sizeof(Initializer*));
-        for(int i = 0; i < Ty->ArrayLen; ++i) {
-            Init->Children[i] = newInitializer(Ty->Base, false);
-        }
     }
     return Init;
 }
 
+//element I of an array initializer, made when it is first initialized
+static Initializer* arrayChild(Initializer* Init, int I) {
+    if(I >= Init->ChildCap) {
+        int Cap = Init->ChildCap ? Init->ChildCap * 2 : 4;
+        while(Cap <= I)
+            Cap *= 2;
+        Cap = MIN(Cap, Init->Ty->ArrayLen);
+        Initializer** Children = parseAlloc(sizeof(Initializer*) * Cap);
+        if(Init->ChildCnt)
+            memcpy(Children, Init->Children, sizeof(Initializer*) * Init->ChildCnt);
+        Init->Children = Children;
+        Init->ChildCap = Cap;
+    }
+    if(!Init->Children[I])
+        Init->Children[I] = newInitializer(Init->Ty->Base, false);
+    Init->ChildCnt = MAX(Init->ChildCnt, I + 1);
+    return Init->Children[I];
+}
+
+//header plus the part of the payload union the kind uses
+static int nodeSize(NodeKind Kind) {
+    switch(Kind) {
+        case ND_NUM:
+        case ND_VAR:
+        case ND_MEMZERO:
+        case ND_MEMBER:
+        case ND_BLOCK:
+        case ND_STMT_EXPR:
+            return offsetof(Node, Val) + sizeof(int64_t);
+        case ND_FUNCALL:
+            return offsetof(Node, Args) + sizeof(Node*);
+        case ND_GOTO:
+        case ND_LABEL:
+        case ND_CASE:
+            return offsetof(Node, CaseVal) + sizeof(int64_t);
+        case ND_IF:
+        case ND_FOR:
+        case ND_COND:
+        case ND_SWITCH:
+            return sizeof(Node);
+        default:
+            return offsetof(Node, Val);
+    }
+}
+
+//nodes made so far, for --stats
+int64_t NodeCnt;
+
 static Node* newNode(NodeKind Kind,Token* Tok) {
-    Node* Nd = calloc(1, sizeof(Node));
+    ++NodeCnt;
+    Node* Nd = parseAlloc(nodeSize(Kind));
     Nd->Kind = Kind;
     Nd->Tok = Tok;
     return Nd;
@@ -289,9 +401,135 @@ static Node* newNode(NodeKind Kind,Token* Tok) {
 
 }
 
+// constants are folded as the tree is built, to exactly the value the
+// code of genExpr would leave in a0. constExpr turns it off, eval2 does
+// its arithmetic in 64 bits as #if wants
+static bool NoFold;
+
+//register width codegen gives a type, as getTypeId there
+static int regSize(Type* Ty) {
+    switch(Ty->typeKind) {
+        case TypeCHAR:
+            return 1;
+        case TypeSHORT:
+            return 2;
+        case TypeINT:
+            return 4;
+        default:
+            return 8;
+    }
+}
+
+//narrowing sign extends, widening leaves the value alone
+static int64_t castVal(int64_t Val, Type* From, Type* To) {
+    if(To->typeKind == TypeBOOL)
+        return Val != 0;
+    if(regSize(To) >= regSize(From))
+        return Val;
+    switch(regSize(To)) {
+        case 1:
+            return (int8_t)Val;
+        case 2:
+            return (int16_t)Val;
+        default:
+            return (int32_t)Val;
+    }
+}
+
+static Node* foldedNum(Node* Nd, int64_t Val) {
+    Node* Num = newNode(ND_NUM, Nd->Tok);
+    Num->Val = Val;
+    Num->Ty = Nd->Ty;
+    return Num;
+}
+
+static bool isConstInt(Node* Nd) {
+    return Nd->Kind == ND_NUM && isInteger(Nd->Ty);
+}
+
+static Node* foldUnary(Node* Nd) {
+    addType(Nd);
+    if(!isConstInt(Nd->LHS))
+        return Nd;
+    int64_t A = Nd->LHS->Val;
+
+    switch(Nd->Kind) {
+        case ND_NEG:
+            if(Nd->Ty->Size <= 4)
+                return foldedNum(Nd, (int32_t)(0u - (uint32_t)A));
+            return foldedNum(Nd, (int64_t)(0ull - (uint64_t)A));
+        case ND_NOT:
+            return foldedNum(Nd, !A);
+        case ND_BITNOT:
+            return foldedNum(Nd, ~A);
+        default:
+            return Nd;
+    }
+}
+
+static Node* foldBinary(Node* Nd) {
+    addType(Nd);
+    if(!isConstInt(Nd->LHS) || !isConstInt(Nd->RHS))
+        return Nd;
+    int64_t A = Nd->LHS->Val;
+    int64_t B = Nd->RHS->Val;
+    // 32 bit instructions, as the Suffix of genExpr
+    bool W = Nd->LHS->Ty->typeKind != TypeLONG;
+
+    switch(Nd->Kind) {
+        case ND_ADD:
+            return foldedNum(Nd, W ? (int32_t)(A + B) : (int64_t)((uint64_t)A + B));
+        case ND_SUB:
+            return foldedNum(Nd, W ? (int32_t)(A - B) : (int64_t)((uint64_t)A - B));
+        case ND_MUL:
+            return foldedNum(Nd, W ? (int32_t)((uint64_t)A * B) : (int64_t)((uint64_t)A * B));
+        case ND_DIV:
+        case ND_MOD:
+            if(W) {
+                A = (int32_t)A;
+                B = (int32_t)B;
+            }
+            //left to run time, where they do not trap
+            if(B == 0 || B == -1)
+                return Nd;
+            return foldedNum(Nd, Nd->Kind == ND_DIV ? A / B : A % B);
+        case ND_BITAND:
+            return foldedNum(Nd, A & B);
+        case ND_BITOR:
+            return foldedNum(Nd, A | B);
+        case ND_BITXOR:
+            return foldedNum(Nd, A ^ B);
+        case ND_SHL:
+            if(W)
+                return foldedNum(Nd, (int32_t)((uint32_t)A << (B & 31)));
+            return foldedNum(Nd, (int64_t)((uint64_t)A << (B & 63)));
+        case ND_SHR:
+            if(W)
+                return foldedNum(Nd, (int32_t)A >> (B & 31));
+            return foldedNum(Nd, A >> (B & 63));
+        case ND_EQ:
+            return foldedNum(Nd, A == B);
+        case ND_NE:
+            return foldedNum(Nd, A != B);
+        case ND_LT:
+            return foldedNum(Nd, A < B);
+        case ND_LE:
+            return foldedNum(Nd, A <= B);
+        case ND_LOGAND:
+            return foldedNum(Nd, A && B);
+        case ND_LOGOR:
+            return foldedNum(Nd, A || B);
+        default:
+            return Nd;
+    }
+}
+
 static Node* newUnary(NodeKind Kind, Node* Expr, Token* Tok) {
     Node* Nd = newNode(Kind, Tok);
     Nd->LHS = Expr;
+    if(!NoFold && Expr->Kind == ND_NUM &&
+       (Kind == ND_NEG || Kind == ND_NOT || Kind == ND_BITNOT))
+        return foldUnary(Nd);
     return Nd;
 }
 
@@ -299,6 +537,9 @@ static Node* newBinary(NodeKind Kind, Node* LHS, Node* RHS, Token* Tok) {
     Node* Nd = newNode(Kind, Tok);
     Nd->LHS = LHS;
     Nd->RHS = RHS;
+    if(!NoFold && LHS->Kind == ND_NUM && RHS->Kind == ND_NUM &&
+       Kind != ND_ASSIGN && Kind != ND_COMMA)
+        return foldBinary(Nd);
     return Nd;
 }
 
@@ -321,15 +562,15 @@ static Node* newVarNode(Obj* Var, Token* Tok) {
     return Nd;
 }
 
-static Obj* newVar(char* Name, Type* Ty) {
-    Obj* Var = calloc(1, sizeof(Obj));
+static Obj* newVar(char* Name, Type* Ty, Arena* A) {
+    Obj* Var = arenaAlloc(A, sizeof(Obj));
     Var->Name = Name;
     Var->Ty = Ty;
     pushScope(Name)->Vars = Var;
     return Var;
 }
 static Obj* newLVar(char* Name, Type* Ty) {
-    Obj* Var = newVar(Name, Ty);
+    Obj* Var = newVar(Name, Ty, FuncArena);
     Var->IsLocal = true;
     Var->Next = Locals;
     Locals = Var;
@@ -337,7 +578,7 @@ static Obj* newLVar(char* Name, Type* Ty) {
 }
 
 static Obj* newGVar(char* Name, Type* Ty) {
-    Obj* Var = newVar(Name, Ty);
+    Obj* Var = newVar(Name, Ty, &GlobalArena);
     Var->IsDefinition = true;
     Var->Next = Globals;
     Globals = Var;
@@ -479,17 +720,22 @@ Type* declarator(Token** Rest, Token* Tok, Type* Ty) {
 static char* genIdent(Token* Tok) {
     if(Tok->Kind != TK_IDENT)
         errorTok(Tok, "expected identifier");
-    return strndup(Tok->Pos, Tok->Len);
+    return Tok->Ident;
 }
 
 Node* newCast(Node* Expr, Type* Ty) {
     addType(Expr);
 
-    Node* Nd = calloc(1, sizeof(Node));
-    Nd->Tok = Expr->Tok;
-    Nd->Kind = ND_CAST;
+    if(!NoFold && isConstInt(Expr) && isInteger(Ty)) {
+        Node* Nd = newNode(ND_NUM, Expr->Tok);
+        Nd->Val = castVal(Expr->Val, Expr->Ty, Ty);
+        Nd->Ty = Ty;
+        return Nd;
+    }
+
+    Node* Nd = newNode(ND_CAST, Expr->Tok);
     Nd->LHS = Expr;
-    Nd->Ty = copyType(Ty);
+    Nd->Ty = Ty;
     return Nd;
 }
 
@@ -558,7 +804,7 @@ static void createParamLVars(Type* Param) {
 static void resolveGotoLabels(void) {
     for(Node* X = Gotos; X; X = X->GotoNext) {
         for(Node* Y = Labels; Y; Y = Y->GotoNext) {
-            if(!strcmp(X->Label, Y->Label)) {
+            if(X->Label == Y->Label) {
                 X->UniqueLabel = Y->UniqueLabel;
                 break;
             }
@@ -664,9 +910,48 @@ Obj* newAnonGVar(Type* Ty) {
     return newGVar(newUniqueName(), Ty);
 }
 
+// string literals with the same bytes share one object
+static Obj** StrPool;
+static int StrPoolCap;
+static int StrPoolCnt;
+
+static Obj** findStrSlot(char* Str, int Size) {
+    uint32_t I = fnvHash(Str, Size) & (StrPoolCap - 1);
+    for(; StrPool[I]; I = (I + 1) & (StrPoolCap - 1)) {
+        Obj* Var = StrPool[I];
+        if(Var->Ty->Size == Size && !memcmp(Var->InitData, Str, Size))
+            break;
+    }
+    return &StrPool[I];
+}
+
+static void rehashStrPool(void) {
+    Obj** Old = StrPool;
+    int OldCap = StrPoolCap;
+
+    StrPoolCap = StrPoolCap ? StrPoolCap * 2 : 256;
+    StrPool = calloc(StrPoolCap, sizeof(Obj*));
+    for(int I = 0; I < OldCap; ++I) {
+        if(Old[I])
+            *findStrSlot(Old[I]->InitData, Old[I]->Ty->Size) = Old[I];
+    }
+    free(Old);
+}
+
 static Obj* newStringLiteral(char* Str, Type* Ty) {
+    // keep the load factor under 1/2
+    if(StrPoolCnt * 2 >= StrPoolCap)
+        rehashStrPool();
+
+    Obj** Slot = findStrSlot(Str, Ty->Size);
+    if(*Slot)
+        return *Slot;
+
     Obj* Var = newAnonGVar(Ty);
     Var->InitData = Str;
+    Var->IsLiteral = true;
+    *Slot = Var;
+    ++StrPoolCnt;
     return Var;
 }
 
@@ -692,61 +977,6 @@ static Type* typename(Token** Rest, Token* Tok) {
     return abstractDeclarator(Rest, Tok, Ty);
 }
 
-static Node* logOr(Token** Rest, Token* Tok) {
-    Node* Nd = logAnd(&Tok, Tok);
-
-    while(equal(Tok, "||")) {
-        Token* Start = Tok;
-        Nd = newBinary(ND_LOGOR, Nd, logAnd(&Tok, Tok->Next), Start);
-    }
-    *Rest = Tok;
-    return Nd;
-}
-
-static Node* logAnd(Token** Rest, Token* Tok) {
-    Node* Nd = bitOr(&Tok, Tok);
-
-    while(equal(Tok, "&&")) {
-        Token* Start = Tok;
-        Nd = newBinary(ND_LOGAND, Nd, bitOr(&Tok, Tok->Next), Start);
-    }
-    *Rest = Tok;
-    return Nd;
-}
-
-static Node* bitOr(Token** Rest, Token* Tok) {
-    Node* Nd = bitXor(&Tok, Tok);
-
-    while(equal(Tok, "|")) {
-        Token* Start = Tok;
-        Nd = newBinary(ND_BITOR, Nd, bitXor(&Tok, Tok->Next), Start);
-    }
-    *Rest = Tok;
-    return Nd;
-}
-
-static Node* bitXor(Token** Rest, Token* Tok) {
-    Node* Nd = bitAnd(&Tok, Tok);
-
-    while(equal(Tok, "^")) {
-        Token* Start = Tok;
-        Nd = newBinary(ND_BITXOR, Nd, bitOr(&Tok, Tok->Next), Start);
-    }
-    *Rest = Tok;
-    return Nd;
-}
-
-static Node* bitAnd(Token** Rest, Token* Tok) {
-    Node* Nd = equality(&Tok, Tok);
-
-    while(equal(Tok, "&")) {
-        Token* Start = Tok;
-        Nd = newBinary(ND_BITAND, Nd, equality(&Tok, Tok->Next), Start);
-    }
-    *Rest = Tok;
-    return Nd;
-}
-
 static Node* compoundStmt(Token** Rest, Token* Tok) {
    Node* Nd = newNode(ND_BLOCK, Tok);
    Node Head = {};
@@ -761,17 +991,23 @@ static Node* compoundStmt(Token** Rest, Token* Tok) {
                 continue;
            }
            
-           if(isFunction(Tok)) {
-               Tok = function(Tok, BaseTy, &Attr);
-               continue;
+           // the first declarator is parsed once, a function type makes
+           // it a prototype, one followed by ',' is left to declaration()
+           Type* Ty = NULL;
+           if(!equal(Tok, ";")) {
+               Ty = declarator(&Tok, Tok, BaseTy);
+               if(isFuncDecl(Ty, Tok)) {
+                   Tok = function(Tok, Ty, &Attr);
+                   continue;
+               }
            }
 
            if(Attr.IsExtern) {
-               Tok = globalVariable(Tok, BaseTy, &Attr);
+               Tok = globalVariable(Tok, BaseTy, Ty, &Attr);
                continue;
            }
 
-           Cur->Next  = declaration(&Tok, Tok, BaseTy);
+           Cur->Next  = declaration(&Tok, Tok, BaseTy, Ty);
        }else {
            Cur->Next = stmt(&Tok, Tok);
        }
@@ -784,20 +1020,28 @@ static Node* compoundStmt(Token** Rest, Token* Tok) {
    return Nd;
 }
 
-static Node* declaration(Token** Rest, Token* Tok, Type* BaseTy) {
+// Ty is the first declarator if the caller has parsed it, else NULL
+static Node* declaration(Token** Rest, Token* Tok, Type* BaseTy, Type* Ty) {
     Node Head = {};
     Node* Cur = &Head;
     
-    int I = 0;
+    int I = Ty ? 1 : 0;
 
-    while(!equal(Tok, ";")) {
-        if(I++ > 0) {
-            Tok = skip(Tok, ",");
+    while(Ty || !equal(Tok, ";")) {
+        if(!Ty) {
+            if(I++ > 0) {
+                Tok = skip(Tok, ",");
+            }
+            Ty = declarator(&Tok, Tok, BaseTy);
         }
         
-        Type* Ty = declarator(&Tok, Tok, BaseTy);
         if(Ty->typeKind == TypeVOID)
             errorTok(Tok, "variable declared void");
+        if(Ty->typeKind == TypeFunc) {
+            declareFunc(Ty, false);
+            Ty = NULL;
+            continue;
+        }
 
         Obj* Var = newLVar(genIdent(Ty->Name), Ty);//regist varibles
 
@@ -810,6 +1054,7 @@ static Node* declaration(Token** Rest, Token* Tok, Type* BaseTy) {
             errorTok(Tok, "variable has incomplete type");
         if(Var->Ty->typeKind == TypeVOID)
             errorTok(Tok, "variable declared void");
+        Ty = NULL;
     }
     
     Node* Nd = newNode(ND_BLOCK, Tok);
@@ -835,11 +1080,21 @@ static void stringInitializer(Token** Rest, Token* Tok, Initializer* Init) {
     }
     int Len = MIN(Init->Ty->ArrayLen, Tok->Ty->ArrayLen);
     for(int i = 0; i < Len; ++i) {
-        Init->Children[i]->Expr = newNum(Tok->Str[i], Tok);
+        arrayChild(Init, i)->Expr = newNum(Tok->Str[i], Tok);
     }
     *Rest = Tok->Next;
 }
 
+// the number token of an element that is just an integer literal, maybe
+// negated, NULL for anything else
+static Token* plainNum(Token* Tok) {
+    if(equal(Tok, "-"))
+        Tok = Tok->Next;
+    if(Tok->Kind == TK_NUM && (equal(Tok->Next, ",") || equal(Tok->Next, "}")))
+        return Tok;
+    return NULL;
+}
+
 static int counterArrayInitElements(Token* Tok, Type* Ty) {
     Initializer* Dummy = newInitializer(Ty->Base, false);
     int i = 0;
@@ -847,22 +1102,62 @@ static int counterArrayInitElements(Token* Tok, Type* Ty) {
     for(; !consumeEnd(&Tok, Tok); ++i) {
         if(i != 0)
             Tok = skip(Tok, ",");
-        initializer2(&Tok, Tok, Dummy);
+        Token* Num = plainNum(Tok);
+        if(Num)
+            Tok = Num->Next;
+        else
+            initializer2(&Tok, Tok, Dummy);
     }
     return i;
 }
 
+// tables of numbers skip the expression parser, their leading run of plain
+// integer literals goes straight into Init->Data
+static void denseArrayInit(Token** Rest, Token* Tok, Initializer* Init) {
+    Type* Base = Init->Ty->Base;
+    if(!isInteger(Base))
+        return;
+
+    int Sz = Base->Size;
+    int Cap = 0;
+    int I = 0;
+    for(; I < Init->Ty->ArrayLen; ++I) {
+        Token* T = Tok;
+        if(I > 0) {
+            if(!equal(T, ","))
+                break;
+            T = T->Next;
+        }
+        Token* Num = plainNum(T);
+        if(!Num)
+            break;
+
+        int64_t Val = Num == T ? Num->Val : (int64_t)(0ull - (uint64_t)Num->Val);
+        if(Base->typeKind == TypeBOOL)
+            Val = Val != 0;
+        if(I == Cap) {
+            Cap = MIN(Cap ? Cap * 2 : 64, Init->Ty->ArrayLen);
+            Init->Data = realloc(Init->Data, (size_t)Cap * Sz);
+        }
+        writeBuf(Init->Data + (size_t)I * Sz, Val, Sz);
+        Tok = Num->Next;
+    }
+    Init->DataCnt = I;
+    *Rest = Tok;
+}
+
 static void arrayInitializer1(Token** Rest, Token* Tok, Initializer* Init) {
    Tok = skip(Tok, "{");
    if(Init->IsFlexible) {
        int Len = counterArrayInitElements(Tok, Init->Ty);
        *Init = *newInitializer(arrayof(Init->Ty->Base, Len), false);
    }
-   for(int i = 0 ; !consumeEnd(Rest, Tok) ; ++i) {
+   denseArrayInit(&Tok, Tok, Init);
+   for(int i = Init->DataCnt; !consumeEnd(Rest, Tok) ; ++i) {
        if(i > 0)
            Tok = skip(Tok, ",");
        if(i < Init->Ty->ArrayLen)
-           initializer2(&Tok, Tok, Init->Children[i]);
+           initializer2(&Tok, Tok, arrayChild(Init, i));
        else
            Tok = skipExcessElement(Tok);
    }
@@ -877,7 +1172,7 @@ static void arrayInitializer2(Token** Rest, Token* Tok, Initializer* Init) {
    for(int i = 0; i < Init->Ty->ArrayLen && !isEnd(Tok); ++i) {
        if(i > 0)
            Tok = skip(Tok, ",");
-       initializer2(&Tok, Tok, Init->Children[i]);
+       initializer2(&Tok, Tok, arrayChild(Init, i));
    }
    *Rest = Tok;
 }
@@ -965,20 +1260,21 @@ static void initializer2(Token** Rest, Token* Tok, Initializer* Init) { //the re
     Init->Expr = assign(Rest, Tok);
 }
 
+static void indexMembers(Type* Ty);
+
 static Type* copyStructType(Type* Ty) {
     Ty = copyType(Ty);
 
-    Member* Mem = calloc(1, sizeof(Member));
-
     Member Head = {};
     Member* Cur = &Head;
     for(Member* mem = Ty->Mem; mem; mem = mem->Next) {
-        Member* M = calloc(1, sizeof(Member));
+        Member* M = arenaAlloc(&GlobalArena, sizeof(Member));
         *M = *mem;
         Cur->Next = M;
         Cur = Cur->Next;
     }
     Ty->Mem = Head.Next;
+    indexMembers(Ty);
     return Ty;
 }
 
@@ -988,11 +1284,7 @@ static Initializer* initializer(Token** Rest, Token* Tok, Type* Ty, Type** NewTy
 
    if((Ty->typeKind == TypeUNION || Ty->typeKind == TypeSTRUCT) && Ty->IsFlexible) {
        Ty = copyStructType(Ty);
-       Member* Mem = Ty->Mem;
-       
-       while(Mem->Next)
-           Mem = Mem->Next;
-
+       Member* Mem = Ty->Mems[Ty->MemCnt - 1];
        Mem->Ty = Init->Children[Mem->Idx]->Ty;
        Ty->Size += Mem->Ty->Size;
        *NewTy = Ty;
@@ -1020,7 +1312,16 @@ static Node* initDesigExpr(InitDesig* Desig, Token* Tok) {//calculate the Variab
 static Node* createLVarInit(Initializer* Init, Type* Ty, InitDesig* Desig, Token* Tok) {
     if(Ty->typeKind == TypeARRAY) {
         Node* Nd = newNode(ND_NULL_EXPR, Tok);
-        for(int I = 0; I < Ty->ArrayLen; ++I) {
+        for(int I = 0; I < Init->DataCnt; ++I) {
+            InitDesig Desig2 = {Desig, I};
+            Node* RHS = newNum(readBuf(Init->Data + (size_t)I * Ty->Base->Size, Ty->Base->Size), Tok);
+            RHS = newBinary(ND_ASSIGN, initDesigExpr(&Desig2, Tok), RHS, Tok);
+            Nd = newBinary(ND_COMMA, Nd, RHS, Tok);
+        }
+        // the rest is left zero by ND_MEMZERO
+        for(int I = 0; I < Init->ChildCnt; ++I) {
+            if(!Init->Children[I])
+                continue;
             InitDesig Desig2 = {Desig, I};
             Node* RHS = createLVarInit(Init->Children[I], Ty->Base, &Desig2, Tok);
             Nd = newBinary(ND_COMMA, Nd, RHS, Tok);
@@ -1073,11 +1374,24 @@ static void writeBuf(char* Buf, uint64_t Val, int Sz) {
     }
 }
 
+static int64_t readBuf(char* Buf, int Sz) {
+    if(Sz == 1)
+        return *(int8_t*)Buf;
+    if(Sz == 2)
+        return *(int16_t*)Buf;
+    if(Sz == 4)
+        return *(int32_t*)Buf;
+    return *(int64_t*)Buf;
+}
+
 static Relocation* writeGVarData(Relocation* Cur, Initializer* Init, Type* Ty, char* Buf, int Offset) {
     if(Ty->typeKind == TypeARRAY) {
         int Sz = Ty->Base->Size;
-        for(int i = 0; i < Ty->ArrayLen; ++i) {
-            Cur = writeGVarData(Cur, Init->Children[i], Ty->Base, Buf, Offset + Sz * i);
+        if(Init->DataCnt)
+            memcpy(Buf + Offset, Init->Data, (size_t)Init->DataCnt * Sz);
+        for(int i = 0; i < Init->ChildCnt; ++i) {
+            if(Init->Children[i])
+                Cur = writeGVarData(Cur, Init->Children[i], Ty->Base, Buf, Offset + Sz * i);
         }
         return Cur;
     }
@@ -1100,11 +1414,14 @@ static Relocation* writeGVarData(Relocation* Cur, Initializer* Init, Type* Ty, c
     char* Label = NULL;
     uint64_t Val = eval2(Init->Expr, &Label);
     if(!Label) {
+        //a _Bool holds 0 or 1
+        if(Ty->typeKind == TypeBOOL)
+            Val = Val != 0;
         writeBuf(Buf + Offset, Val, Ty->Size);
         return Cur;
     }
 
-    Relocation* Rel = calloc(1, sizeof(Relocation));
+    Relocation* Rel = arenaAlloc(&GlobalArena, sizeof(Relocation));
     Rel->Label = Label;
     Rel->Offset = Offset;
     Rel->Addend = Val;
@@ -1118,7 +1435,7 @@ static void GVarInitializer(Token** Rest, Token* Tok, Obj* Var) {
     Initializer* Init = initializer(Rest, Tok, Var->Ty, &Var->Ty);
     Relocation Head = {};
 
-    char *Buf = calloc(1, sizeof(Var->Ty->Size));
+    char *Buf = calloc(1, Var->Ty->Size);
 
     writeGVarData(&Head, Init, Var->Ty, Buf, 0);
     
@@ -1183,10 +1500,10 @@ static Node* stmt(Token** Rest, Token* Tok){
         Nd->Label = newUniqueName();
         Nd->LHS = stmt(Rest, Tok);
 
-        Nd->Val = Val;
+        Nd->CaseVal = Val;
 
-        Nd->CaseNext = CurrentSwitch->CaseNext;
-        CurrentSwitch->CaseNext = Nd;
+        Nd->CaseNext = CurrentSwitch->Cases;
+        CurrentSwitch->Cases = Nd;
         
         return Nd;
     }
@@ -1216,7 +1533,7 @@ static Node* stmt(Token** Rest, Token* Tok){
         ContLabel = Nd->ContLabel = newUniqueName();
         if(isTypename(Tok)) {
             Type* BaseTy = declspec(&Tok, Tok, NULL);
-            Nd->Init = declaration(&Tok, Tok, BaseTy);
+            Nd->Init = declaration(&Tok, Tok, BaseTy, NULL);
         }else {
             Nd->Init = exprStmt(&Tok, Tok);
         }
@@ -1281,7 +1598,7 @@ static Node* stmt(Token** Rest, Token* Tok){
     
     if(Tok->Kind == TK_IDENT && equal(Tok->Next, ":")) {
         Node* Nd = newNode(ND_LABEL, Tok);
-        Nd->Label = strndup(Tok->Pos, Tok->Len); 
+        Nd->Label = Tok->Ident;
         Nd->UniqueLabel = newUniqueName();
         Nd->LHS = stmt(Rest, Tok->Next->Next);
         
@@ -1312,11 +1629,18 @@ static int64_t eval2(Node* Nd, char** Label) {
         case ND_MUL:
             return eval(Nd->LHS) * eval(Nd->RHS);
         case ND_DIV:
-            return eval(Nd->LHS) / eval(Nd->RHS);
+        case ND_MOD: {
+            int64_t A = eval(Nd->LHS);
+            int64_t B = eval(Nd->RHS);
+            if(B == 0)
+                errorTok(Nd->Tok, "division by zero");
+            //INT64_MIN / -1 traps on the host, it wraps as the hardware does
+            if(B == -1)
+                return Nd->Kind == ND_DIV ? (int64_t)(0ull - (uint64_t)A) : 0;
+            return Nd->Kind == ND_DIV ? A / B : A % B;
+        }
         case ND_NEG:
             return -eval(Nd->LHS);
-        case ND_MOD:
-            return eval(Nd->LHS) % eval(Nd->RHS);
         case ND_BITAND:
             return eval(Nd->LHS) & eval(Nd->RHS);
         case ND_BITOR:
@@ -1349,16 +1673,8 @@ static int64_t eval2(Node* Nd, char** Label) {
             return eval(Nd->LHS) || eval(Nd->RHS);
         case ND_CAST: {
             int64_t Val = eval2(Nd->LHS, Label);
-            if(isInteger(Nd->Ty)) {
-                  switch(Nd->Ty->Size){
-                    case 1:
-                        return (uint8_t)Val;
-                    case 2:
-                        return (uint16_t)Val;
-                    case 4:
-                        return (uint32_t)Val;
-                  }
-            }
+            if(isInteger(Nd->Ty))
+                return castVal(Val, Nd->LHS->Ty, Nd->Ty);
             return Val;
         }
         case ND_NUM:
@@ -1403,8 +1719,11 @@ static int64_t evalRVal(Node* Nd, char** Label) {
     return -1;
 }
 
-static int64_t constExpr(Token** Rest, Token* Tok) {
+int64_t constExpr(Token** Rest, Token* Tok) {
+    bool Fold = NoFold;
+    NoFold = true;
     Node* Nd = conditional(Rest, Tok);
+    NoFold = Fold;
     return eval(Nd);
 }
 
@@ -1448,9 +1767,9 @@ static Node* toAssign(Node* Binary) {
 }
 
 static Node* conditional(Token** Rest, Token* Tok) {
-    Node* Cond = logOr(&Tok, Tok);
+    Node* Cond = binary(&Tok, Tok, 1);
 
-    if(!equal(Tok, "?")) {
+    if(Tok->Kind != TK_PUNCT || Tok->Punct != '?') {
         *Rest = Tok;
         return Cond;
     }
@@ -1469,140 +1788,85 @@ static Node* conditional(Token** Rest, Token* Tok) {
 
 static Node* assign(Token** Rest, Token* Tok) {
     Node* Nd = conditional(&Tok, Tok);
-    
-    if(equal(Tok, "=")) {
-        Nd = newBinary(ND_ASSIGN, Nd, assign(&Tok, Tok->Next), Tok);    
-    }
-
-    if(equal(Tok, "+=")) {
-        return toAssign(newAdd(Nd, assign(Rest, Tok->Next), Tok));    
-    }
-    
-    if(equal(Tok, "-=")) {
-        return toAssign(newSub(Nd, assign(Rest, Tok->Next), Tok));    
-    }
-
-    if(equal(Tok, "*=")) {
-        return toAssign(newBinary(ND_MUL, Nd, assign(Rest, Tok->Next), Tok));    
-    }
-
-    if(equal(Tok, "/=")) {
-        return toAssign(newBinary(ND_DIV, Nd, assign(Rest, Tok->Next), Tok));    
-    }
-    
-    if(equal(Tok, "%=")) {
-        return toAssign(newBinary(ND_MOD, Nd, assign(Rest, Tok->Next), Tok));   
-    }
-
-    if(equal(Tok, "&=")) {
-        return toAssign(newBinary(ND_BITAND, Nd, assign(Rest, Tok->Next), Tok));   
-    }
 
-    if(equal(Tok, "|=")) {
-        return toAssign(newBinary(ND_BITOR, Nd, assign(Rest, Tok->Next), Tok));   
-    }
-
-    if(equal(Tok, "^=")) {
-        return toAssign(newBinary(ND_BITXOR, Nd, assign(Rest, Tok->Next), Tok));   
-    }
-    
-    if(equal(Tok, "<<=")) {
-        return toAssign(newBinary(ND_SHL, Nd, assign(Rest, Tok->Next), Tok));   
-    }
-    
-    if(equal(Tok, ">>=")) {
-        return toAssign(newBinary(ND_SHR, Nd, assign(Rest, Tok->Next), Tok));   
-    }
-
-    *Rest = Tok;
-    return Nd;
-}
-
-static Node* equality(Token** Rest, Token* Tok) {
-    Node* Nd = relational(&Tok, Tok);
-    while(1) {
-        if(equal(Tok, "==")) {
-            Nd = newBinary(ND_EQ, Nd, relational(&Tok, Tok->Next), Tok);
-            continue;
-        }else if(equal(Tok, "!=")) {
-            Nd = newBinary(ND_NE, Nd, relational(&Tok, Tok->Next), Tok);
-            continue;
-        }
+    // 'A op= B' is 'A = A op B'
+    if(Tok->Kind != TK_PUNCT) {
         *Rest = Tok;
         return Nd;
     }
-}
-
-static Node* relational(Token** Rest, Token* Tok) {
-    Node* Nd = shift(&Tok, Tok);
-    while(1) {
-        if(equal(Tok, "<")) {
-            Nd = newBinary(ND_LT, Nd, shift(&Tok, Tok->Next), Tok);
-            continue;
-        }else if(equal(Tok, ">")) {
-            Nd = newBinary(ND_LT, shift(&Tok, Tok->Next), Nd, Tok);
-            continue;
-        }else if(equal(Tok, ">=")) {
-            Nd = newBinary(ND_LE, shift(&Tok, Tok->Next), Nd, Tok);
-            continue;
-        }else if(equal(Tok, "<=")) {
-            Nd = newBinary(ND_LE, Nd, shift(&Tok, Tok->Next), Tok);
-            continue;
-        }
-        *Rest = Tok;
-        return Nd;
-    }
-}
-
-static Node* shift(Token** Rest, Token* Tok) {
-    Node* Nd = add(&Tok, Tok);
-
-    while(1) {
-        Token* Start = Tok;
-        if(equal(Tok, "<<")) {
-            Nd = newBinary(ND_SHL, Nd, add(&Tok, Tok->Next), Start);
-            continue;
-        }
-        if(equal(Tok, ">>")) {
-            Nd = newBinary(ND_SHR, Nd, add(&Tok, Tok->Next), Start);
-            continue;
-        }
-        *Rest = Tok;
-        return Nd;
+    NodeKind Kind;
+    //int, '=' is a single char punctuator and has no name in PunctKind
+    switch((int)Tok->Punct) {
+        case '=':
+            return newBinary(ND_ASSIGN, Nd, assign(Rest, Tok->Next), Tok);
+        case PT_ADD_ASSIGN:
+            return toAssign(newAdd(Nd, assign(Rest, Tok->Next), Tok));
+        case PT_SUB_ASSIGN:
+            return toAssign(newSub(Nd, assign(Rest, Tok->Next), Tok));
+        case PT_MUL_ASSIGN: Kind = ND_MUL; break;
+        case PT_DIV_ASSIGN: Kind = ND_DIV; break;
+        case PT_MOD_ASSIGN: Kind = ND_MOD; break;
+        case PT_AND_ASSIGN: Kind = ND_BITAND; break;
+        case PT_OR_ASSIGN: Kind = ND_BITOR; break;
+        case PT_XOR_ASSIGN: Kind = ND_BITXOR; break;
+        case PT_SHL_ASSIGN: Kind = ND_SHL; break;
+        case PT_SHR_ASSIGN: Kind = ND_SHR; break;
+        default:
+            *Rest = Tok;
+            return Nd;
     }
+    return toAssign(newBinary(Kind, Nd, assign(Rest, Tok->Next), Tok));
 }
 
-static Node* add(Token** Rest, Token* Tok) {
-    Node* Nd = mul(&Tok, Tok);
-    while(1) {
-        if(equal(Tok, "+")) {
-            Nd = newAdd(Nd, mul(&Tok, Tok->Next), Tok);
-            continue;
-        }else if(equal(Tok, "-")) {
-            Nd = newSub(Nd, mul(&Tok, Tok->Next), Tok);
-            continue;
-        }
-        *Rest = Tok;
-        return Nd;
-    }
-}
+// binary operators by punctuator ID, a higher Prec binds tighter and
+// Prec 0 is not a binary operator
+typedef struct {
+    int Prec;
+    NodeKind Kind;
+    bool Swap;      //'A > B' is 'B < A'
+} BinaryOp;
+
+static BinaryOp BinaryOps[PT_ELLIPSIS + 1] = {
+    [PT_LOGOR] = {1, ND_LOGOR},
+    [PT_LOGAND] = {2, ND_LOGAND},
+    ['|'] = {3, ND_BITOR},
+    ['^'] = {4, ND_BITXOR},
+    ['&'] = {5, ND_BITAND},
+    [PT_EQ] = {6, ND_EQ},
+    [PT_NE] = {6, ND_NE},
+    ['<'] = {7, ND_LT},
+    [PT_LE] = {7, ND_LE},
+    ['>'] = {7, ND_LT, true},
+    [PT_GE] = {7, ND_LE, true},
+    [PT_SHL] = {8, ND_SHL},
+    [PT_SHR] = {8, ND_SHR},
+    ['+'] = {9, ND_ADD},
+    ['-'] = {9, ND_SUB},
+    ['*'] = {10, ND_MUL},
+    ['/'] = {10, ND_DIV},
+    ['%'] = {10, ND_MOD},
+};
 
-static Node* mul(Token** Rest, Token* Tok) {
+// precedence climbing over the left associative binary operators, the
+// operand only descends as far as the next operator needs
+static Node* binary(Token** Rest, Token* Tok, int MinPrec) {
     Node* Nd = cast(&Tok, Tok);
     while(1) {
-        Token* Start = Tok;
-        if(equal(Tok, "*")) {
-            Nd = newBinary(ND_MUL, Nd, cast(&Tok, Tok->Next), Start);
-            continue;
-        }else if(equal(Tok, "/")) {
-            Nd = newBinary(ND_DIV, Nd, cast(&Tok, Tok->Next), Start);
-            continue;
-        }else if(equal(Tok, "%")) {
-            Nd = newBinary(ND_MOD, Nd, cast(&Tok, Tok->Next), Start);
-            continue;
+        BinaryOp* Op = &BinaryOps[Tok->Kind == TK_PUNCT ? Tok->Punct : PT_NONE];
+        if(Op->Prec < MinPrec || Op->Prec == 0) {
+            *Rest = Tok;
+            return Nd;
         }
-        *Rest = Tok;
-        return Nd;
+        Token* Start = Tok;
+        Node* RHS = binary(&Tok, Tok->Next, Op->Prec + 1);
+        if(Op->Kind == ND_ADD)
+            Nd = newAdd(Nd, RHS, Start);
+        else if(Op->Kind == ND_SUB)
+            Nd = newSub(Nd, RHS, Start);
+        else if(Op->Swap)
+            Nd = newBinary(Op->Kind, RHS, Nd, Start);
+        else
+            Nd = newBinary(Op->Kind, Nd, RHS, Start);
     }
 }
 
@@ -1780,7 +2044,7 @@ static Node* funcall(Token** Rest, Token* Tok) {
         addType(Cur);//for type cast align
     }
     Node* Nd = newNode(ND_FUNCALL, Start);
-    Nd->FuncName = strndup(Start->Pos, Start->Len);
+    Nd->FuncName = Start->Ident;
     Nd->FuncType = Ty;
     Nd->Ty = Ty->ReturnTy;
     Nd->Args = Head.Next;
@@ -1788,19 +2052,34 @@ static Node* funcall(Token** Rest, Token* Tok) {
     return Nd;
 }
 
-static Token* function(Token* Tok, Type* BaseTy, VarAttr* Attr) {
-    Type* Ty = declarator(&Tok, Tok, BaseTy);
+//a function declarator which function() takes, one ending the declaration
+//or starting a body
+static bool isFuncDecl(Type* Ty, Token* Tok) {
+    return Ty->typeKind == TypeFunc && (equal(Tok, ";") || equal(Tok, "{"));
+}
 
+//a declarator of function type declares a function wherever it stands,
+//not only as the first declarator
+static Obj* declareFunc(Type* Ty, bool IsStatic) {
     Obj* Fn = newGVar(genIdent(Ty->Name), Ty);
     Fn->IsFunction = true;
+    Fn->IsDefinition = false;
+    Fn->IsStatic = IsStatic;
+    return Fn;
+}
 
+// Tok follows the declarator, already parsed into Ty
+static Token* function(Token* Tok, Type* Ty, VarAttr* Attr) {
+    Obj* Fn = declareFunc(Ty, Attr->IsStatic);
     Fn->IsDefinition = !consume(&Tok, Tok, ";");
-    Fn->IsStatic = Attr->IsStatic;
     if(!Fn->IsDefinition)
         return Tok;
 
     CurrentFunc = Fn;
     Locals = NULL;
+    //freed by codegen once the function is emitted
+    Fn->Arena = calloc(1, sizeof(Arena));
+    FuncArena = Fn->Arena;
     enterScope(); 
     createParamLVars(Ty->Param);
     Fn->Param = Locals;
@@ -1810,32 +2089,63 @@ static Token* function(Token* Tok, Type* BaseTy, VarAttr* Attr) {
     Fn->Locals = Locals;
     leaveScope();
     resolveGotoLabels();
+    FuncArena = NULL;
     return Tok;
 }
 
-static Token* globalVariable(Token* Tok, Type* BaseTy, VarAttr* Attr) {
+// Ty is the first declarator if the caller has parsed it, else NULL
+static Token* globalVariable(Token* Tok, Type* BaseTy, Type* Ty, VarAttr* Attr) {
     bool First = true;
-    while(!consume(&Tok, Tok, ";")) {
-        if(!First)
-            Tok = skip(Tok, ",");
+    while(Ty || !consume(&Tok, Tok, ";")) {
+        if(!Ty) {
+            if(!First)
+                Tok = skip(Tok, ",");
+            Ty = declarator(&Tok, Tok, BaseTy);
+        }
         First = false;
-        Type* Ty = declarator(&Tok, Tok, BaseTy);
+        if(Ty->typeKind == TypeFunc) {
+            declareFunc(Ty, Attr->IsStatic);
+            Ty = NULL;
+            continue;
+        }
         Obj* Var = newGVar(genIdent(Ty->Name), Ty);
         Var->IsDefinition = !Attr->IsExtern;
         if(equal(Tok, "=")) {
             GVarInitializer(&Tok, Tok->Next, Var);
         }
+        Ty = NULL;
     }
     return Tok;
 }
 
-static bool isFunction(Token* Tok) {
-    if(equal(Tok, ";"))
-        return false;
-    
-    Type Dummy = {};
-    Type* Ty = declarator(&Tok, Tok, &Dummy);
-    return Ty->typeKind == TypeFunc;
+static Member** findMemberSlot(Type* Ty, char* Name) {
+    uint32_t I = nameHash(Name) & (Ty->MemIndexCap - 1);
+    while(Ty->MemIndex[I] && Ty->MemIndex[I]->Name != Name)
+        I = (I + 1) & (Ty->MemIndexCap - 1);
+    return &Ty->MemIndex[I];
+}
+
+// members in an array by Idx and in a hash by name, built once per struct
+static void indexMembers(Type* Ty) {
+    int Cnt = 0;
+    for(Member* Mem = Ty->Mem; Mem; Mem = Mem->Next)
+        ++Cnt;
+    Ty->MemCnt = Cnt;
+    Ty->Mems = arenaAlloc(&GlobalArena, sizeof(Member*) * Cnt);
+
+    // load factor at most 1/2
+    Ty->MemIndexCap = 1;
+    while(Ty->MemIndexCap < Cnt * 2)
+        Ty->MemIndexCap *= 2;
+    Ty->MemIndex = arenaAlloc(&GlobalArena, sizeof(Member*) * Ty->MemIndexCap);
+
+    for(Member* Mem = Ty->Mem; Mem; Mem = Mem->Next) {
+        Ty->Mems[Mem->Idx] = Mem;
+        Member** Slot = findMemberSlot(Ty, Mem->Name);
+        if(*Slot)
+            errorTok(Mem->Tok, "duplicate member");
+        *Slot = Mem;
+    }
 }
 
 static void structMembers(Token** Rest, Token* Tok, Type* Ty){
@@ -1850,9 +2160,10 @@ static void structMembers(Token** Rest, Token* Tok, Type* Ty){
                 Tok = skip(Tok, ",");
             }
             First = false;
-            Member* Mem = calloc(1, sizeof(Member));
+            Member* Mem = arenaAlloc(&GlobalArena, sizeof(Member));
             Mem->Ty = declarator(&Tok, Tok, BaseTy);
-            Mem->Name = Mem->Ty->Name;
+            Mem->Tok = Mem->Ty->Name;
+            Mem->Name = Mem->Tok->Ident;
             Mem->Idx = Idx++;
             Cur = Cur->Next = Mem;
         }
@@ -1864,6 +2175,7 @@ static void structMembers(Token** Rest, Token* Tok, Type* Ty){
     }
     *Rest = Tok->Next;
     Ty->Mem = Head.Next;
+    indexMembers(Ty);
 }
 
 static Type* structUnionDecl(Token** Rest, Token* Tok) { //struct declaration
@@ -1890,11 +2202,11 @@ static Type* structUnionDecl(Token** Rest, Token* Tok) { //struct declaration
     structMembers(Rest, Tok, Ty); //struct members Inits
     
     if(Tag) {
-        for(TagScope *S = Scp->Tags; S; S = S->Next) {
-            if(equal(Tag, S->Name)) {
-                *(S->Ty) = *Ty;
-                return S->Ty;
-            }
+        //completes a tag declared in this very scope
+        TagScope* S = findTagScope(Tag);
+        if(S && S->Depth == ScopeDepth) {
+            *(S->Ty) = *Ty;
+            return S->Ty;
         }
         pushTagScope(Tag, Ty);
     }
@@ -1978,10 +2290,10 @@ static Type* enumSpecifier(Token** Rest, Token* Tok) {
 }
 
 static Member* getStructMember(Type* Ty, Token* Tok) {
-    for(Member* mem = Ty->Mem; mem; mem = mem->Next) {
-        if (mem->Name->Len == Tok->Len &&
-        !strncmp(mem->Name->Pos, Tok->Pos, Tok->Len))
-        return mem;
+    if(Ty->MemIndex) {
+        Member* Mem = *findMemberSlot(Ty, Tok->Ident);
+        if(Mem)
+            return Mem;
     }
     errorTok(Tok, "no such member");
     return NULL;
@@ -2010,20 +2322,38 @@ static Token* parseTypedef(Token* Tok, Type* BaseTy) {
 
 }
 
-Obj* parse(Token *Tok) {
+// Tok holds one top level declaration at a time, the next one is pulled
+// from the tokenizer once it is parsed. functions are emitted to Out as
+// soon as they are parsed, the data of the globals is left to codegen
+Obj* parse(Token *Tok, FILE* Out) {
     Globals = NULL;
     while(Tok->Kind != TK_EOF) {
-        VarAttr Attr = {};
-        Type* BaseTy = declspec(&Tok, Tok, &Attr);
-        if(Attr.IsTypedef) {
-            Tok = parseTypedef(Tok, BaseTy);
-            continue;
-        }
-        if(isFunction(Tok)){
-            Tok = function(Tok, BaseTy, &Attr);
-            continue;
+        while(Tok->Kind != TK_EOF) {
+            VarAttr Attr = {};
+            Type* BaseTy = declspec(&Tok, Tok, &Attr);
+            if(Attr.IsTypedef) {
+                Tok = parseTypedef(Tok, BaseTy);
+                continue;
+            }
+            // the first declarator is parsed once, its type tells a
+            // function from variables, a function followed by ',' is left
+            // to globalVariable()
+            Type* Ty = NULL;
+            if(!equal(Tok, ";")) {
+                Ty = declarator(&Tok, Tok, BaseTy);
+                if(isFuncDecl(Ty, Tok)){
+                    // function() sets CurrentFunc only for a definition
+                    CurrentFunc = NULL;
+                    Tok = function(Tok, Ty, &Attr);
+                    // frees the nodes, nothing is left pointing at the tokens
+                    if(CurrentFunc)
+                        codegenFunction(CurrentFunc, Out);
+                    continue;
+                }
+            }
+            Tok = globalVariable(Tok, BaseTy, Ty, &Attr);
         }
-        Tok = globalVariable(Tok, BaseTy, &Attr);    
+        Tok = tokenizeDecl();
     }
     return Globals;
 }
@@ -0,0 +1,899 @@
+/* ************************************************************************
+> File Name:     preprocess.c
+> Author:        ferdi
+> Created Time:  Sat 09 Mar 2024 04:12:45 PM CST
+> Description:
+ ************************************************************************/
+#include "rvcc.h"
+
+/*Preprocessor*/
+typedef struct MacroParam MacroParam;
+struct MacroParam {
+    MacroParam* Next;
+    char* Name;     //interned
+};
+
+typedef struct MacroArg MacroArg;
+struct MacroArg {
+    MacroArg* Next;
+    char* Name;     //interned
+    Token* Tok;     //ends with a TK_EOF
+};
+
+typedef struct Macro Macro;
+struct Macro {
+    Macro* Next;    //next in the bucket
+    char* Name;     //interned
+    bool IsObjlike;
+    MacroParam* Params;
+    bool IsVariadic;
+    Token* Body;    //ends with a TK_EOF
+};
+
+// #if #ifdef #ifndef being inside
+typedef struct CondIncl CondIncl;
+struct CondIncl {
+    CondIncl* Next;
+    enum { IN_THEN, IN_ELIF, IN_ELSE } Ctx;
+    Token* Tok;
+    bool Included;
+};
+
+// a header is lexed once, later #include copy its tokens
+typedef struct IncludedFile IncludedFile;
+struct IncludedFile {
+    IncludedFile* Next;
+    char* Path;
+    Token* Tok;     //never linked into the output
+    char* Guard;    //macro of the include guard, NULL if none
+    bool PragmaOnce;
+};
+
+//macros hashed by the address of their interned name
+#define MACRO_BUCKETS 1024
+static Macro* Macros[MACRO_BUCKETS];
+
+static CondIncl* Conds;
+static IncludedFile* Included;
+
+// where the parts of the input come from, the headers being read are
+// stacked on the input file
+typedef struct Source Source;
+struct Source {
+    Source* Next;
+    Token* Tok;     //rest of a kept header, NULL for the input file
+};
+static Source* Sources;
+
+//the input file is read a part at a time, Input is the next token and the
+//pending input ends with InputEnd, which refill() turns into the next part
+static Token* Input;
+static Token* InputEnd;
+
+//-I directories
+static char** IncludePaths;
+static int IncludePathCnt;
+
+//searched after the -I directories, as gcc -E did
+static char* SysIncludePaths[] = {"/usr/local/include", "/usr/include", NULL};
+
+static Token* preprocess2(Token* Tok);
+
+void addIncludePath(char* Dir) {
+    IncludePaths = realloc(IncludePaths, sizeof(char*) * (IncludePathCnt + 1));
+    IncludePaths[IncludePathCnt++] = Dir;
+}
+
+//a '#' starting a line
+static bool isHash(Token* Tok) {
+    return Tok->AtBOL && Tok->Kind == TK_PUNCT && Tok->Punct == '#';
+}
+
+//interned spelling of an identifier, a keyword may name a macro too
+static char* identOf(Token* Tok) {
+    if(Tok->Kind == TK_IDENT)
+        return Tok->Ident;
+    if(Tok->Kind == TK_KEYWORD)
+        return intern(Tok->Pos, Tok->Len);
+    return NULL;
+}
+
+static Token* newNumToken(int64_t Val, Token* Tok) {
+    Token* T = copyToken(Tok);
+    T->Kind = TK_NUM;
+    T->Val = Val;
+    return T;
+}
+
+//read the next part in place of InputEnd, false at the real end of input
+static bool refill(void) {
+    while(Sources) {
+        Token* Part = Sources->Tok ? copyPart(&Sources->Tok, Sources->Tok) : tokenizeMore();
+        if(Part->Kind != TK_EOF) {
+            Token* End = Part;
+            while(End->Kind != TK_EOF)
+                End = End->Next;
+            *InputEnd = *Part;
+            InputEnd = End;
+            return true;
+        }
+        //the end of the input file is where the parser sees it
+        if(!Sources->Tok)
+            *InputEnd = *Part;
+        Sources = Sources->Next;
+    }
+    return false;
+}
+
+//Tok is a TK_EOF which no next part can take the place of
+static bool atEnd(Token* Tok) {
+    return Tok->Kind == TK_EOF && !(Tok == InputEnd && refill());
+}
+
+//copy Tok1 up to its TK_EOF and go on with Tok2
+static Token* append(Token* Tok1, Token* Tok2) {
+    Token Head = {};
+    Token* Cur = &Head;
+    for(; Tok1->Kind != TK_EOF; Tok1 = Tok1->Next) {
+        Cur->Next = copyToken(Tok1);
+        Cur = Cur->Next;
+    }
+    Cur->Next = Tok2;
+    return Head.Next;
+}
+
+//extra tokens after a directive are ignored
+static Token* skipLine(Token* Tok) {
+    while(!Tok->AtBOL && Tok->Kind != TK_EOF)
+        Tok = Tok->Next;
+    return Tok;
+}
+
+//copy the rest of the line, ending it with a TK_EOF
+static Token* copyLine(Token** Rest, Token* Tok) {
+    Token Head = {};
+    Token* Cur = &Head;
+    for(; !Tok->AtBOL && Tok->Kind != TK_EOF; Tok = Tok->Next) {
+        Cur->Next = copyToken(Tok);
+        Cur = Cur->Next;
+    }
+    Cur->Next = newEOF(Tok);
+    *Rest = Tok;
+    return Head.Next;
+}
+
+static Hideset* newHideset(char* Name) {
+    Hideset* HS = calloc(1, sizeof(Hideset));
+    HS->Name = Name;
+    return HS;
+}
+
+static Hideset* hidesetUnion(Hideset* HS1, Hideset* HS2) {
+    Hideset Head = {};
+    Hideset* Cur = &Head;
+    for(; HS1; HS1 = HS1->Next) {
+        Cur->Next = newHideset(HS1->Name);
+        Cur = Cur->Next;
+    }
+    Cur->Next = HS2;
+    return Head.Next;
+}
+
+static bool hidesetContains(Hideset* HS, char* Name) {
+    for(; HS; HS = HS->Next) {
+        if(HS->Name == Name)
+            return true;
+    }
+    return false;
+}
+
+static Hideset* hidesetIntersection(Hideset* HS1, Hideset* HS2) {
+    Hideset Head = {};
+    Hideset* Cur = &Head;
+    for(; HS1; HS1 = HS1->Next) {
+        if(hidesetContains(HS2, HS1->Name)) {
+            Cur->Next = newHideset(HS1->Name);
+            Cur = Cur->Next;
+        }
+    }
+    return Head.Next;
+}
+
+//copy Tok, adding HS to the hideset of every token
+static Token* addHideset(Token* Tok, Hideset* HS) {
+    Token Head = {};
+    Token* Cur = &Head;
+    for(; Tok; Tok = Tok->Next) {
+        Cur->Next = copyToken(Tok);
+        Cur = Cur->Next;
+        Cur->Hideset = hidesetUnion(Cur->Hideset, HS);
+    }
+    return Head.Next;
+}
+
+static Macro** macroSlot(char* Name) {
+    Macro** Slot = &Macros[((uintptr_t)Name >> 3) % MACRO_BUCKETS];
+    while(*Slot && (*Slot)->Name != Name)
+        Slot = &(*Slot)->Next;
+    return Slot;
+}
+
+static Macro* findMacro(Token* Tok) {
+    char* Name = identOf(Tok);
+    return Name ? *macroSlot(Name) : NULL;
+}
+
+static Macro* addMacro(char* Name, bool IsObjlike, Token* Body) {
+    Macro** Slot = macroSlot(Name);
+    //a redefinition replaces the macro
+    if(!*Slot)
+        *Slot = calloc(1, sizeof(Macro));
+    Macro* M = *Slot;
+    M->Name = Name;
+    M->IsObjlike = IsObjlike;
+    M->Params = NULL;
+    M->IsVariadic = false;
+    M->Body = Body;
+    return M;
+}
+
+static void undefMacro(char* Name) {
+    Macro** Slot = macroSlot(Name);
+    if(*Slot)
+        *Slot = (*Slot)->Next;
+}
+
+static char* macroName(Token* Tok) {
+    char* Name = identOf(Tok);
+    if(!Name)
+        errorTok(Tok, "macro name must be an identifier");
+    return Name;
+}
+
+static MacroParam* readMacroParams(Token** Rest, Token* Tok, bool* IsVariadic) {
+    MacroParam Head = {};
+    MacroParam* Cur = &Head;
+    while(!equal(Tok, ")")) {
+        if(Cur != &Head)
+            Tok = skip(Tok, ",");
+        if(equal(Tok, "...")) {
+            *IsVariadic = true;
+            *Rest = skip(Tok->Next, ")");
+            return Head.Next;
+        }
+        Cur->Next = calloc(1, sizeof(MacroParam));
+        Cur = Cur->Next;
+        Cur->Name = macroName(Tok);
+        Tok = Tok->Next;
+    }
+    *Rest = Tok->Next;
+    return Head.Next;
+}
+
+static void readMacroDefinition(Token** Rest, Token* Tok) {
+    char* Name = macroName(Tok);
+    Tok = Tok->Next;
+    //"(" right after the name makes a function-like macro
+    if(!Tok->HasSpace && equal(Tok, "(")) {
+        bool IsVariadic = false;
+        MacroParam* Params = readMacroParams(&Tok, Tok->Next, &IsVariadic);
+        Macro* M = addMacro(Name, false, copyLine(Rest, Tok));
+        M->Params = Params;
+        M->IsVariadic = IsVariadic;
+        return;
+    }
+    addMacro(Name, true, copyLine(Rest, Tok));
+}
+
+//one argument, or all the rest of them for "..."
+static MacroArg* readMacroArgOne(Token** Rest, Token* Tok, bool ReadRest) {
+    Token Head = {};
+    Token* Cur = &Head;
+    int Level = 0;
+    while(!atEnd(Tok) && (Level > 0 || !(equal(Tok, ")") || (!ReadRest && equal(Tok, ","))))) {
+        if(equal(Tok, "("))
+            ++Level;
+        else if(equal(Tok, ")"))
+            --Level;
+        Cur->Next = copyToken(Tok);
+        Cur = Cur->Next;
+        Tok = Tok->Next;
+    }
+    if(Tok->Kind == TK_EOF)
+        errorTok(Tok, "premature end of input");
+    Cur->Next = newEOF(Tok);
+
+    MacroArg* Arg = calloc(1, sizeof(MacroArg));
+    Arg->Tok = Head.Next;
+    *Rest = Tok;
+    return Arg;
+}
+
+//Tok is the macro name, *Rest gets the closing ')'
+static MacroArg* readMacroArgs(Token** Rest, Token* Tok, Macro* M) {
+    Tok = Tok->Next->Next;
+
+    MacroArg Head = {};
+    MacroArg* Cur = &Head;
+    for(MacroParam* PP = M->Params; PP; PP = PP->Next) {
+        if(Cur != &Head)
+            Tok = skip(Tok, ",");
+        Cur->Next = readMacroArgOne(&Tok, Tok, false);
+        Cur = Cur->Next;
+        Cur->Name = PP->Name;
+    }
+
+    if(M->IsVariadic) {
+        if(!atEnd(Tok) && equal(Tok, ")")) {
+            Cur->Next = calloc(1, sizeof(MacroArg));
+            Cur->Next->Tok = newEOF(Tok);
+        }else {
+            if(Cur != &Head)
+                Tok = skip(Tok, ",");
+            Cur->Next = readMacroArgOne(&Tok, Tok, true);
+        }
+        Cur = Cur->Next;
+        Cur->Name = intern("__VA_ARGS__", 11);
+    }
+
+    if(atEnd(Tok) || !equal(Tok, ")"))
+        errorTok(Tok, "too many arguments");
+    *Rest = Tok;
+    return Head.Next;
+}
+
+static MacroArg* findArg(MacroArg* Args, Token* Tok) {
+    char* Name = identOf(Tok);
+    for(; Name && Args; Args = Args->Next) {
+        if(Args->Name == Name)
+            return Args;
+    }
+    return NULL;
+}
+
+//spelling of the tokens, one space wherever there was whitespace
+static char* joinTokens(Token* Tok, Token* End) {
+    int Len = 1;
+    for(Token* T = Tok; T != End && T->Kind != TK_EOF; T = T->Next)
+        Len += T->Len + (T != Tok && T->HasSpace);
+
+    char* Buf = calloc(1, Len);
+    int Pos = 0;
+    for(Token* T = Tok; T != End && T->Kind != TK_EOF; T = T->Next) {
+        if(T != Tok && T->HasSpace)
+            Buf[Pos++] = ' ';
+        memcpy(Buf + Pos, T->Pos, T->Len);
+        Pos += T->Len;
+    }
+    return Buf;
+}
+
+// "#x" turns the argument into a string literal
+static Token* stringize(Token* Hash, Token* Arg) {
+    char* Str = joinTokens(Arg, NULL);
+    char* Buf = calloc(1, strlen(Str) * 2 + 3);
+    int Pos = 0;
+    Buf[Pos++] = '"';
+    for(char* P = Str; *P; ++P) {
+        if(*P == '\\' || *P == '"')
+            Buf[Pos++] = '\\';
+        Buf[Pos++] = *P;
+    }
+    Buf[Pos++] = '"';
+    return tokenizeFragment(Buf, Hash);
+}
+
+// "x ## y" glues the two tokens into one
+static Token* paste(Token* LHS, Token* RHS) {
+    char* Buf = format("%.*s%.*s", LHS->Len, LHS->Pos, RHS->Len, RHS->Pos);
+    Token* Tok = tokenizeFragment(Buf, LHS);
+    if(Tok->Next->Kind != TK_EOF)
+        errorTok(LHS, "pasting forms '%s', an invalid token", Buf);
+    return Tok;
+}
+
+//copy the tokens of an argument after Cur
+static Token* appendArg(Token* Cur, Token* Arg) {
+    for(; Arg->Kind != TK_EOF; Arg = Arg->Next) {
+        Cur->Next = copyToken(Arg);
+        Cur = Cur->Next;
+    }
+    return Cur;
+}
+
+//replace the parameters in the body of a function-like macro
+static Token* subst(Token* Tok, MacroArg* Args) {
+    Token Head = {};
+    Token* Cur = &Head;
+
+    while(Tok->Kind != TK_EOF) {
+        if(equal(Tok, "#")) {
+            MacroArg* Arg = findArg(Args, Tok->Next);
+            if(!Arg)
+                errorTok(Tok->Next, "'#' is not followed by a macro parameter");
+            Cur->Next = stringize(Tok, Arg->Tok);
+            Cur = Cur->Next;
+            Tok = Tok->Next->Next;
+            continue;
+        }
+
+        if(equal(Tok, "##")) {
+            if(Cur == &Head)
+                errorTok(Tok, "'##' cannot appear at start of macro expansion");
+            if(Tok->Next->Kind == TK_EOF)
+                errorTok(Tok, "'##' cannot appear at end of macro expansion");
+
+            MacroArg* Arg = findArg(Args, Tok->Next);
+            if(!Arg) {
+                *Cur = *paste(Cur, Tok->Next);
+            }else if(Arg->Tok->Kind != TK_EOF) {
+                //an argument is pasted unexpanded, only its first token is glued
+                *Cur = *paste(Cur, Arg->Tok);
+                Cur = appendArg(Cur, Arg->Tok->Next);
+            }
+            Tok = Tok->Next->Next;
+            continue;
+        }
+
+        MacroArg* Arg = findArg(Args, Tok);
+
+        //the left side of "##" is not expanded either
+        if(Arg && equal(Tok->Next, "##")) {
+            Token* RHS = Tok->Next->Next;
+            if(Arg->Tok->Kind != TK_EOF) {
+                Cur = appendArg(Cur, Arg->Tok);
+                Tok = Tok->Next;
+                continue;
+            }
+            //an empty left side leaves the right one alone
+            MacroArg* Arg2 = findArg(Args, RHS);
+            if(Arg2) {
+                Cur = appendArg(Cur, Arg2->Tok);
+            }else {
+                Cur->Next = copyToken(RHS);
+                Cur = Cur->Next;
+            }
+            Tok = RHS->Next;
+            continue;
+        }
+
+        //any other argument is fully expanded first, on a copy as "#" or
+        //"##" may still want it as written
+        if(Arg) {
+            Token* T = preprocess2(append(Arg->Tok, newEOF(Tok)));
+            T->AtBOL = Tok->AtBOL;
+            T->HasSpace = Tok->HasSpace;
+            Cur = appendArg(Cur, T);
+            Tok = Tok->Next;
+            continue;
+        }
+
+        Cur->Next = copyToken(Tok);
+        Cur = Cur->Next;
+        Tok = Tok->Next;
+    }
+    Cur->Next = Tok;
+    return Head.Next;
+}
+
+//expand Tok if it is a macro, *Rest gets the expansion followed by the
+//tokens after the macro call
+static bool expandMacro(Token** Rest, Token* Tok) {
+    Macro* M = findMacro(Tok);
+    if(!M || hidesetContains(Tok->Hideset, M->Name))
+        return false;
+
+    Token* Body;
+    Token* Next;
+    if(M->IsObjlike) {
+        Body = addHideset(M->Body, hidesetUnion(Tok->Hideset, newHideset(M->Name)));
+        Next = Tok->Next;
+    }else {
+        //a function-like macro name without arguments is a plain identifier
+        if(atEnd(Tok->Next) || !equal(Tok->Next, "("))
+            return false;
+        Token* RParen;
+        MacroArg* Args = readMacroArgs(&RParen, Tok, M);
+        Hideset* HS = hidesetIntersection(Tok->Hideset, RParen->Hideset);
+        HS = hidesetUnion(HS, newHideset(M->Name));
+        Body = addHideset(subst(M->Body, Args), HS);
+        Next = RParen->Next;
+    }
+
+    if(Body->Kind != TK_EOF) {
+        Body->AtBOL = Tok->AtBOL;
+        Body->HasSpace = Tok->HasSpace;
+    }
+    *Rest = append(Body, Next);
+    return true;
+}
+
+static bool isCondStart(Token* Tok) {
+    return equal(Tok, "if") || equal(Tok, "ifdef") || equal(Tok, "ifndef");
+}
+
+//skip a nested #if ... #endif
+static Token* skipCondIncl2(Token* Tok) {
+    while(!atEnd(Tok)) {
+        if(isHash(Tok) && isCondStart(Tok->Next)) {
+            Tok = skipCondIncl2(Tok->Next->Next);
+            continue;
+        }
+        if(isHash(Tok) && equal(Tok->Next, "endif"))
+            return Tok->Next->Next;
+        Tok = Tok->Next;
+    }
+    return Tok;
+}
+
+//skip a false branch up to its #elif #else or #endif
+static Token* skipCondIncl(Token* Tok) {
+    while(!atEnd(Tok)) {
+        if(isHash(Tok) && isCondStart(Tok->Next)) {
+            Tok = skipCondIncl2(Tok->Next->Next);
+            continue;
+        }
+        if(isHash(Tok) && (equal(Tok->Next, "elif") || equal(Tok->Next, "else") ||
+                           equal(Tok->Next, "endif")))
+            break;
+        Tok = Tok->Next;
+    }
+    return Tok;
+}
+
+static void pushCondIncl(Token* Tok, bool Included) {
+    CondIncl* CI = calloc(1, sizeof(CondIncl));
+    CI->Next = Conds;
+    CI->Ctx = IN_THEN;
+    //kept for the error at the end of input
+    keepTokens(true);
+    CI->Tok = copyToken(Tok);
+    keepTokens(false);
+    CI->Included = Included;
+    Conds = CI;
+}
+
+//Tok is the "if" or "elif", the condition is the rest of the line
+static int64_t evalConstExpr(Token** Rest, Token* Tok) {
+    Token* Start = Tok;
+    Token* Line = copyLine(Rest, Tok->Next);
+
+    // "defined(X)" and "defined X" turn into 1 or 0 before expanding
+    Token Head = {};
+    Token* Cur = &Head;
+    while(Line->Kind != TK_EOF) {
+        if(equal(Line, "defined")) {
+            Token* Defined = Line;
+            bool HasParen = consume(&Line, Line->Next, "(");
+            macroName(Line);
+            Cur->Next = newNumToken(findMacro(Line) ? 1 : 0, Defined);
+            Cur = Cur->Next;
+            Line = Line->Next;
+            if(HasParen)
+                Line = skip(Line, ")");
+            continue;
+        }
+        Cur->Next = Line;
+        Cur = Cur->Next;
+        Line = Line->Next;
+    }
+    Cur->Next = Line;
+
+    Token* Expr = preprocess2(Head.Next);
+    if(Expr->Kind == TK_EOF)
+        errorTok(Start, "no expression");
+
+    //identifiers left after expansion are 0
+    for(Token* T = Expr; T->Kind != TK_EOF; T = T->Next) {
+        if(T->Kind == TK_IDENT || T->Kind == TK_KEYWORD) {
+            T->Kind = TK_NUM;
+            T->Val = 0;
+        }
+    }
+
+    Token* End;
+    int64_t Val = constExpr(&End, Expr);
+    if(End->Kind != TK_EOF)
+        errorTok(End, "extra token");
+    return Val;
+}
+
+static IncludedFile* findIncluded(char* Path) {
+    for(IncludedFile* Inc = Included; Inc; Inc = Inc->Next) {
+        if(!strcmp(Inc->Path, Path))
+            return Inc;
+    }
+    return NULL;
+}
+
+// "#ifndef X #define X ... #endif" around the whole file, X is the guard
+static char* detectIncludeGuard(Token* Tok) {
+    if(!isHash(Tok) || !equal(Tok->Next, "ifndef") || Tok->Next->Next->Kind != TK_IDENT)
+        return NULL;
+    char* Guard = Tok->Next->Next->Ident;
+    Tok = Tok->Next->Next->Next;
+    if(!isHash(Tok) || !equal(Tok->Next, "define") || identOf(Tok->Next->Next) != Guard)
+        return NULL;
+
+    //the #ifndef has neither #elif nor #else and its #endif is the last token
+    while(Tok->Kind != TK_EOF) {
+        if(!isHash(Tok)) {
+            Tok = Tok->Next;
+            continue;
+        }
+        if(isCondStart(Tok->Next)) {
+            Tok = skipCondIncl2(Tok->Next->Next);
+            continue;
+        }
+        if(equal(Tok->Next, "endif"))
+            return Tok->Next->Next->Kind == TK_EOF ? Guard : NULL;
+        if(equal(Tok->Next, "elif") || equal(Tok->Next, "else"))
+            return NULL;
+        Tok = Tok->Next;
+    }
+    return NULL;
+}
+
+static Token* includeFile(Token* Tok, char* Path) {
+    IncludedFile* Inc = findIncluded(Path);
+    if(!Inc) {
+        Inc = calloc(1, sizeof(IncludedFile));
+        Inc->Path = Path;
+        Inc->Tok = tokenizeInclude(Path);
+        Inc->Guard = detectIncludeGuard(Inc->Tok);
+        Inc->Next = Included;
+        Included = Inc;
+    }else if(Inc->PragmaOnce || (Inc->Guard && *macroSlot(Inc->Guard))) {
+        //nothing more to get out of it
+        return Tok;
+    }
+
+    //read a part at a time too when the #include ends the pending input
+    if(Tok == InputEnd) {
+        Source* S = calloc(1, sizeof(Source));
+        S->Tok = Inc->Tok;
+        S->Next = Sources;
+        Sources = S;
+        return Tok;
+    }
+    return append(Inc->Tok, Tok);
+}
+
+static bool fileExists(char* Path) {
+    struct stat St;
+    return stat(Path, &St) == 0;
+}
+
+// "foo.h" is looked for next to the file including it first, then in -I
+// and the system directories
+static char* searchInclude(char* Filename, bool IsDquote, Token* Tok) {
+    if(Filename[0] == '/')
+        return fileExists(Filename) ? Filename : NULL;
+
+    if(IsDquote) {
+        char* Name = Tok->File->Name;
+        char* Slash = strrchr(Name, '/');
+        char* Path = Slash ? format("%.*s/%s", (int)(Slash - Name), Name, Filename) : Filename;
+        if(fileExists(Path))
+            return Path;
+    }
+
+    for(int I = 0; I < IncludePathCnt; ++I) {
+        char* Path = format("%s/%s", IncludePaths[I], Filename);
+        if(fileExists(Path))
+            return Path;
+    }
+    for(char** Dir = SysIncludePaths; *Dir; ++Dir) {
+        char* Path = format("%s/%s", *Dir, Filename);
+        if(fileExists(Path))
+            return Path;
+    }
+    return NULL;
+}
+
+// "foo.h" or <foo.h>
+static char* readIncludeFilename(Token** Rest, Token* Tok, bool* IsDquote) {
+    if(Tok->Kind == TK_STR) {
+        *IsDquote = true;
+        *Rest = skipLine(Tok->Next);
+        return strndup(Tok->Pos + 1, Tok->Len - 2);
+    }
+
+    if(equal(Tok, "<")) {
+        Token* Start = Tok->Next;
+        for(Tok = Start; !equal(Tok, ">"); Tok = Tok->Next) {
+            if(Tok->AtBOL || Tok->Kind == TK_EOF)
+                errorTok(Tok, "expected '>'");
+        }
+        *IsDquote = false;
+        *Rest = skipLine(Tok->Next);
+        return joinTokens(Start, Tok);
+    }
+
+    errorTok(Tok, "expected a filename");
+    return NULL;
+}
+
+//Start is the '#' of a directive, returns the input after its line
+static Token* directive(Token* Start) {
+    Token* Tok = Start->Next;
+
+    if(equal(Tok, "include")) {
+        bool IsDquote;
+        char* Filename = readIncludeFilename(&Tok, Tok->Next, &IsDquote);
+        char* Path = searchInclude(Filename, IsDquote, Start);
+        if(!Path)
+            errorTok(Start->Next->Next, "%s: cannot open file", Filename);
+        return includeFile(Tok, Path);
+    }
+
+    if(equal(Tok, "define")) {
+        //the body outlives the declaration it is in
+        keepTokens(true);
+        readMacroDefinition(&Tok, Tok->Next);
+        keepTokens(false);
+        return Tok;
+    }
+
+    if(equal(Tok, "undef")) {
+        undefMacro(macroName(Tok->Next));
+        return skipLine(Tok->Next->Next);
+    }
+
+    if(equal(Tok, "if")) {
+        int64_t Val = evalConstExpr(&Tok, Tok);
+        pushCondIncl(Start, Val);
+        if(!Val)
+            Tok = skipCondIncl(Tok);
+        return Tok;
+    }
+
+    if(equal(Tok, "ifdef") || equal(Tok, "ifndef")) {
+        macroName(Tok->Next);
+        bool Defined = findMacro(Tok->Next);
+        bool Val = equal(Tok, "ifdef") ? Defined : !Defined;
+        pushCondIncl(Start, Val);
+        Tok = skipLine(Tok->Next->Next);
+        if(!Val)
+            Tok = skipCondIncl(Tok);
+        return Tok;
+    }
+
+    if(equal(Tok, "elif")) {
+        if(!Conds || Conds->Ctx == IN_ELSE)
+            errorTok(Start, "stray #elif");
+        Conds->Ctx = IN_ELIF;
+        if(!Conds->Included && evalConstExpr(&Tok, Tok))
+            Conds->Included = true;
+        else
+            Tok = skipCondIncl(Tok);
+        return Tok;
+    }
+
+    if(equal(Tok, "else")) {
+        if(!Conds || Conds->Ctx == IN_ELSE)
+            errorTok(Start, "stray #else");
+        Conds->Ctx = IN_ELSE;
+        Tok = skipLine(Tok->Next);
+        if(Conds->Included)
+            Tok = skipCondIncl(Tok);
+        return Tok;
+    }
+
+    if(equal(Tok, "endif")) {
+        if(!Conds)
+            errorTok(Start, "stray #endif");
+        Conds = Conds->Next;
+        return skipLine(Tok->Next);
+    }
+
+    if(equal(Tok, "pragma")) {
+        if(equal(Tok->Next, "once")) {
+            IncludedFile* Inc = findIncluded(Tok->File->Name);
+            if(Inc)
+                Inc->PragmaOnce = true;
+        }
+        //other pragmas are ignored
+        return skipLine(Tok->Next);
+    }
+
+    if(equal(Tok, "error"))
+        errorTok(Tok, "error");
+
+    // "#" alone on its line
+    if(Tok->AtBOL || Tok->Kind == TK_EOF)
+        return Tok;
+
+    errorTok(Tok, "invalid preprocessor directive");
+    return NULL;
+}
+
+static Token* preprocess2(Token* Tok) {
+    Token Head = {};
+    Token* Cur = &Head;
+
+    while(Tok->Kind != TK_EOF) {
+        if(expandMacro(&Tok, Tok))
+            continue;
+
+        if(!isHash(Tok)) {
+            Cur->Next = Tok;
+            Cur = Cur->Next;
+            Tok = Tok->Next;
+            continue;
+        }
+
+        Tok = directive(Tok);
+    }
+
+    Cur->Next = Tok;
+    return Head.Next;
+}
+
+Token* preprocess(Token* Tok) {
+    Tok = preprocess2(Tok);
+    if(Conds)
+        errorTok(Conds->Tok, "unterminated conditional directive");
+    return Tok;
+}
+
+//macros gcc -E used to predefine, the ones which hold for rvcc
+static char* BuiltinMacros[] = {
+    "__STDC__ 1",
+    "__STDC_VERSION__ 201112",
+    "__STDC_HOSTED__ 1",
+    "__riscv 1",
+    "__riscv_xlen 64",
+    "__LP64__ 1",
+    "_LP64 1",
+    "__CHAR_BIT__ 8",
+    "__SIZEOF_INT__ 4",
+    "__SIZEOF_LONG__ 8",
+    "__SIZEOF_POINTER__ 8",
+    "__rvcc__ 1",
+    NULL,
+};
+
+//define the built-in macros, their tokens are placed at Origin
+void defineBuiltinMacros(Token* Origin) {
+    keepTokens(true);
+    for(char** Def = BuiltinMacros; *Def; ++Def) {
+        Token* Tok = tokenizeFragment(*Def, Origin);
+        addMacro(identOf(Tok), true, Tok->Next);
+    }
+    keepTokens(false);
+}
+
+//start reading the input file a part at a time
+void beginPreprocess(void) {
+    Sources = calloc(1, sizeof(Source));
+    Input = InputEnd = calloc(1, sizeof(Token));
+    Input->Kind = TK_EOF;
+}
+
+//the next token out of the input file, the TK_EOF at the end of it
+Token* preprocessToken(void) {
+    while(1) {
+        if(atEnd(Input)) {
+            if(Conds)
+                errorTok(Conds->Tok, "unterminated conditional directive");
+            return Input;
+        }
+
+        if(expandMacro(&Input, Input))
+            continue;
+
+        if(!isHash(Input)) {
+            Token* Tok = Input;
+            Input = Tok->Next;
+            return Tok;
+        }
+
+        Input = directive(Input);
+    }
+}
+
+//the tokens handed out so far are dead, the pending input is kept
+void recycleInput(void) {
+    Input = recycleTokens(Input, &InputEnd);
+}
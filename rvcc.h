@@ -18,12 +18,34 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <setjmp.h>
+#include <pthread.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 static char *ArgReg[] = {"a0", "a1", "a2", "a3", "a4", "a5"};
 
 typedef struct Type Type;
 typedef struct Node Node;
+typedef struct Arena Arena;
+typedef struct ArenaChunk ArenaChunk;
+
+/*arena allocator*/
+struct Arena {
+    ArenaChunk* Chunks;     //the one being filled first
+    size_t Used;            //bytes used of it
+};
+
+extern _Thread_local Arena GlobalArena;
+void* arenaAlloc(Arena* A, size_t Size);
+void arenaFree(Arena* A);
 typedef struct Member Member;
 typedef struct Relocation Relocation;
 
@@ -36,18 +58,75 @@ typedef enum {
     TK_STR
 } TokenKind;
 
+// punctuator ID, a single char punctuator is its own ASCII code
+typedef enum {
+    PT_NONE,
+    PT_SHL_ASSIGN = 128,    // <<=
+    PT_SHR_ASSIGN,          // >>=
+    PT_EQ,                  // ==
+    PT_NE,                  // !=
+    PT_GE,                  // >=
+    PT_LE,                  // <=
+    PT_ARROW,               // ->
+    PT_ADD_ASSIGN,          // +=
+    PT_SUB_ASSIGN,          // -=
+    PT_MUL_ASSIGN,          // *=
+    PT_DIV_ASSIGN,          // /=
+    PT_MOD_ASSIGN,          // %=
+    PT_AND_ASSIGN,          // &=
+    PT_OR_ASSIGN,           // |=
+    PT_XOR_ASSIGN,          // ^=
+    PT_INC,                 // ++
+    PT_DEC,                 // --
+    PT_LOGAND,              // &&
+    PT_LOGOR,               // ||
+    PT_SHL,                 // <<
+    PT_SHR,                 // >>
+    PT_HASHHASH,            // ##
+    PT_ELLIPSIS,            // ...
+} PunctKind;
+
+typedef struct File File;
+
+// a source file, the input or a header it includes
+struct File {
+    char* Name;
+    int FileNo;         //number in the .file directive
+    char* Contents;
+    //offset of every line start in Contents, LineStarts[LineNo - 1]
+    int* LineStarts;
+    int LineCnt;
+};
+
+typedef struct Hideset Hideset;
+
+// macros which must not expand again in a token coming out of them
+struct Hideset {
+    Hideset* Next;
+    char* Name;     //interned
+};
+
 typedef struct Token Token;
 
 struct Token{
-    TokenKind Kind;
     Token* Next;
-    int64_t Val;
-    int Len;
     char* Pos; 
-
+    //TK_NUM has Val, TK_STR has Str, TK_IDENT has its interned name
+    union {
+        int64_t Val;
+        char* Str;
+        char* Ident;
+    };
     Type* Ty;
-    char* Str;
+    File* File;
+    Hideset* Hideset;
+    int Len;
     int LineNo;
+    //narrowed, so a token still fits in 64 bytes
+    TokenKind Kind : 8;
+    PunctKind Punct : 8;
+    bool AtBOL : 1;     //first token of a line
+    bool HasSpace : 1;  //whitespace before it
 };
 
 bool consume(Token** Rest, Token* Tok, char* Str);
@@ -56,7 +135,25 @@ void errorAt(char *Loc, char *Fmt, ...);
 void errorTok(Token *Tok, char *Fmt, ...);
 bool equal(Token *Tok, char *Str);
 Token *skip(Token *Tok, char *Str);
-Token *tokenizeFile(char *Path);
+Token *tokenizeFile(char *Path, int Threads);
+Token* tokenizeDecl(void);
+Token* tokenizeMore(void);
+Token* tokenizeInclude(char* Path);
+Token* tokenizeFragment(char* Buf, Token* Origin);
+Token* copyPart(Token** Rest, Token* Tok);
+Token* recycleTokens(Token* Tok, Token** End);
+void keepTokens(bool Keep);
+Token* copyToken(Token* Tok);
+Token* newEOF(Token* Tok);
+File** getInputFiles(void);
+
+/*preprocessor*/
+Token* preprocess(Token* Tok);
+void beginPreprocess(void);
+Token* preprocessToken(void);
+void recycleInput(void);
+void addIncludePath(char* Dir);
+void defineBuiltinMacros(Token* Origin);
 
 typedef enum {
     TypeVOID,   //void
@@ -83,6 +180,10 @@ struct Type {
     
     int ArrayLen;
     Member* Mem; 
+    Member** Mems;      //members by Idx
+    int MemCnt;
+    Member** MemIndex;  //members hashed by name
+    int MemIndexCap;
     bool IsFlexible;
     //Function
     Type* ReturnTy;
@@ -103,6 +204,7 @@ struct Obj {
   bool IsFunction;
   bool IsDefinition;
   bool IsStatic;
+  bool IsLiteral; //string literal, read only
  
   Obj* Param;
 
@@ -110,6 +212,7 @@ struct Obj {
   Relocation* Rel; //Pointer to another globle variable 
   Node *Body;    
   Obj *Locals; 
+  Arena* Arena;  //nodes, locals and scopes of the function body
   int StackSize;
 
 };
@@ -180,37 +283,52 @@ extern Type* TypeShort;
 Type* pointerTo(Type* Base);
 
 typedef struct Node Node;
+// a common header plus the payload of the kind, newNode only allocates
+// as much of the union as the kind uses
 struct Node{
     NodeKind Kind;
-    int64_t Val;
+    bool Typed;         //addType has been through it
     Node* Next;
+    Token* Tok;
+    Type* Ty;
     Node* LHS;
     Node* RHS;
-    Obj*  Var;
-    Node* Body;
 
-    char* BrkLabel;
-    char* ContLabel;
-    
-    char* FuncName;
-    Type* FuncType;
-    Node* Args;
-    
-    Member* Mem;
-    Node* Cond;
-    Node* Els;
-    Node* Then;
-    Node* Init;
-    Node* Inc;
-    Node* CaseNext;
-    Node* DefaultCase;
-    char* Label;
-    char* UniqueLabel;
-    Node* GotoNext;
+    union {
+        int64_t Val;        //ND_NUM
+        Obj* Var;           //ND_VAR, ND_MEMZERO
+        Member* Mem;        //ND_MEMBER
+        Node* Body;         //ND_BLOCK, ND_STMT_EXPR
 
-    Token* Tok;
-    Type* Ty;
-   
+        //ND_FUNCALL
+        struct {
+            char* FuncName;
+            Type* FuncType;
+            Node* Args;
+        };
+
+        //ND_GOTO, ND_LABEL, ND_CASE
+        struct {
+            char* Label;
+            char* UniqueLabel;
+            Node* GotoNext;
+            Node* CaseNext;     //next case of the same switch
+            int64_t CaseVal;
+        };
+
+        //ND_IF, ND_FOR, ND_COND, ND_SWITCH
+        struct {
+            Node* Cond;
+            Node* Then;
+            Node* Els;
+            Node* Init;
+            Node* Inc;
+            char* BrkLabel;
+            char* ContLabel;
+            Node* Cases;        //case list of a switch
+            Node* DefaultCase;
+        };
+    };
 };
 
 struct Member {
@@ -218,7 +336,8 @@ struct Member {
     int Idx;
     int Offset;
     Type* Ty;
-    Token* Name;
+    char* Name;     //interned
+    Token* Tok;     //its name, for errors
 };
 
 bool isInteger(Type *TY);
@@ -226,13 +345,19 @@ Type* newType(TypeKind Kind, int Size, int Align);
 
 Type *copyType(Type *Ty);
 void addType(Node* Nd);
+extern int64_t NodeCnt;
+extern int64_t TypeVisits;
 Type* enumType(void);
 Type* structType(void);
 Type* funcType(Type* ReturnTy);
-Obj *parse(Token *Tok);
+Obj *parse(Token *Tok, FILE* Out);
+void codegenFunction(Obj* Fn, FILE* Out);
 void codegen(Obj* Prog, FILE*  Out);
 static Type* typeSuffix(Token** Rest, Token* Tok, Type* Ty); 
 Type* arrayof(Type* Base, int Size);
 static void genStmt(Node *Nd); 
 char *format(char *Fmt, ...);
+char* intern(char* Str, int Len);
+uint32_t fnvHash(char* S, int Len);
 Node* newCast(Node* Expr, Type* Ty);
+int64_t constExpr(Token** Rest, Token* Tok);
@@ -21,3 +21,70 @@ char* format(char* Fmt, ...) {
     fclose(Out);
     return Buf;
 }
+
+// identifier table, every name is stored once so names compare by pointer
+typedef struct {
+    char* Str;
+    int Len;
+    uint32_t Hash;
+} InternEntry;
+
+static InternEntry* InternTable;
+static int InternCap;
+static int InternCnt;
+// the lexer threads share the table
+static pthread_mutex_t InternLock = PTHREAD_MUTEX_INITIALIZER;
+
+uint32_t fnvHash(char* S, int Len) {
+    uint32_t Hash = 2166136261u;
+    for(int I = 0; I < Len; ++I) {
+        Hash ^= (unsigned char)S[I];
+        Hash *= 16777619u;
+    }
+    return Hash;
+}
+
+static void rehashIntern(void) {
+    InternEntry* Old = InternTable;
+    int OldCap = InternCap;
+
+    InternCap = InternCap ? InternCap * 2 : 1024;
+    InternTable = calloc(InternCap, sizeof(InternEntry));
+    for(int I = 0; I < OldCap; ++I) {
+        if(!Old[I].Str)
+            continue;
+        uint32_t J = Old[I].Hash & (InternCap - 1);
+        while(InternTable[J].Str)
+            J = (J + 1) & (InternCap - 1);
+        InternTable[J] = Old[I];
+    }
+    free(Old);
+}
+
+char* intern(char* Str, int Len) {
+    uint32_t Hash = fnvHash(Str, Len);
+
+    pthread_mutex_lock(&InternLock);
+    // keep the load factor under 1/2
+    if(InternCnt * 2 >= InternCap)
+        rehashIntern();
+
+    uint32_t I = Hash & (InternCap - 1);
+    for(; InternTable[I].Str; I = (I + 1) & (InternCap - 1)) {
+        InternEntry* E = &InternTable[I];
+        if(E->Hash == Hash && E->Len == Len && !memcmp(E->Str, Str, Len))
+            break;
+    }
+
+    InternEntry* E = &InternTable[I];
+    if(!E->Str) {
+        E->Str = strndup(Str, Len);
+        E->Len = Len;
+        E->Hash = Hash;
+        ++InternCnt;
+    }
+    // E may move once the lock is released
+    char* Ret = E->Str;
+    pthread_mutex_unlock(&InternLock);
+    return Ret;
+}
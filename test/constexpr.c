@@ -7,6 +7,23 @@
  ************************************************************************/
 #include "test.h"
 
+// 全局变量初始化器和case标签中的窄化转换做符号扩展
+long fold_g1 = (char)200;
+long fold_g2 = (short)40000;
+int fold_g3 = 2147483647 + 1;
+long fold_g4 = (long)65536 * 65536;
+int fold_g5 = 65536 * 65536;
+
+int fold_case(int x) {
+  switch (x) {
+  case (char)200:
+    return 1;
+  case (short)65535:
+    return 2;
+  }
+  return 0;
+}
+
 int main() {
   // [96] 支持常量表达式
   ASSERT(10, ({ enum { ten=1+2+3+4 }; ten; }));
@@ -43,6 +60,51 @@ int main() {
   ASSERT(12, ({ char x[(int*)16-1]; sizeof(x); }));
   ASSERT(3, ({ char x[(int*)16-(int*)4]; sizeof(x); }));
 
+  // 除以0和-1留到运行时，结果与运行时计算的相同
+  ASSERT(-1, 7 / 0);
+  ASSERT(7, 7 % 0);
+  ASSERT(1, ({ int a = 7, b = 0; a / b == 7 / 0 && a % b == 7 % 0; }));
+  ASSERT(-7, 7 / -1);
+  ASSERT(0, 7 % -1);
+  ASSERT(-2147483648, (-2147483647 - 1) / -1);
+  ASSERT(0, (-2147483647 - 1) % -1);
+  ASSERT(1, (-9223372036854775807 - 1) / -1 == -9223372036854775807 - 1);
+  ASSERT(1, ({ long a = -9223372036854775807 - 1, b = -1; a / b == (-9223372036854775807 - 1) / -1; }));
+
+  // int在32位上回绕，long在64位上回绕
+  ASSERT(-2147483648, 2147483647 + 1);
+  ASSERT(2147483647, -2147483647 - 1 - 1);
+  ASSERT(0, 65536 * 65536);
+  ASSERT(1, (long)65536 * 65536 == 4294967296);
+  ASSERT(1, (long)2147483647 + 1 == 2147483648);
+  ASSERT(1, 9223372036854775807 + 1 < 0);
+  ASSERT(-2147483648, fold_g3);
+  ASSERT(1, fold_g4 == 4294967296);
+  ASSERT(0, fold_g5);
+
+  // 移位量按位宽取模
+  ASSERT(1, 1 << 32);
+  ASSERT(2, 1 << 33);
+  ASSERT(-2147483648, 1 << 31);
+  ASSERT(-1, -8 >> 35);
+  ASSERT(1, ((long)1 << 64) == 1);
+  ASSERT(1, ((long)1 << 63) < 0);
+  ASSERT(1, ({ int n = 33; (1 << n) == (1 << 33); }));
+
+  // 常量求值时窄化转换做符号扩展
+  ASSERT(-56, fold_g1);
+  ASSERT(-25536, fold_g2);
+  ASSERT(1, fold_case(-56));
+  ASSERT(0, fold_case(200));
+  ASSERT(2, fold_case(-1));
+  ASSERT(-56, ({ enum { e = (char)200 }; e; }));
+
+  // 数组长度中的窄化转换
+  ASSERT(44, ({ char x[(char)300]; sizeof(x); }));
+  ASSERT(56, ({ char x[(char)-200]; sizeof(x); }));
+  ASSERT(16, ({ int x[(short)65540]; sizeof(x); }));
+  ASSERT(7, ({ char x[(int)4294967303]; sizeof(x); }));
+
   printf("OK\n");
   return 0;
 }
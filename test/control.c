@@ -4,6 +4,25 @@
  * This is a block comment.
  */
 
+// 各类节点只分配自己用到的字段，嵌套的语句不能互相覆盖
+int nest_sw(int x) {
+  int r = 0;
+  for (int i = 0; i < 3; i = i + 1) {
+    switch (x + i) {
+    case 1:
+      { case 2: r = r * 10 + 2; }
+      if (i == 1) continue;
+    case 3:
+      r = r * 10 + (i ? 3 : 4);
+      break;
+    default:
+      switch (i) { case 0: r = r * 10 + 5; break; default: goto out; }
+    }
+  }
+out:
+  return r;
+}
+
 int main() {
 
   ASSERT(5, ({ int i=0; switch(0) { case 0:i=5;break; case 1:i=6;break; case 2:i=7;break; } i; }));
@@ -70,6 +89,14 @@ int main() {
   ASSERT(5, ({ int i=2, j=3; (i=5,j)=6; i; }));
   ASSERT(6, ({ int i=2, j=3; (i=5,j)=6; j; }));
 
+  // 各类节点只分配自己用到的字段，嵌套的语句不能互相覆盖
+  ASSERT(2423, nest_sw(1));
+  ASSERT(243, nest_sw(2));
+  ASSERT(5223, nest_sw(0));
+  ASSERT(4, nest_sw(3));
+  ASSERT(7, ({ int i=0; switch(-3) { case 3: i=5; break; case -3: i=7; break; } i; }));
+  ASSERT(4, ({ int a=1, b=2; a ? b ? 4 : 3 : 2; }));
+
   printf("OK\n");
   return 0;
 }
@@ -7,6 +7,43 @@
  ************************************************************************/
 #include "test.h"
 
+// 顶层声明按结尾的';'或函数体的'}'逐个切分
+struct cut1 { int a; int b; } cut_s = {1, 2};
+int cut_arr[] = {3, 4, 5};
+int cut_call(int x, int y) { return ((x) + (y)); }
+int cut_inc(int x) { if (x) { x = x + 1; } for (;;) { break; } return x; }
+int cut_a = 6, cut_b = (7, 8);
+int cut_h(void);
+int cut_h(void) { return 11; }
+char *cut_str = "}{;";
+int cut_ch = '}';
+typedef struct { int a; } cut_t; cut_t cut_v = {12};
+enum { CUT_A = 13, CUT_B } cut_en = CUT_B;
+struct cut3 { int a; };
+struct cut3 cut3v = {15};
+int cut_d
+  ;
+int
+cut_e
+(
+)
+{
+  return 16;
+}
+
+// 每个声明的第一个声明符只解析一次，是函数类型时才是函数
+int dc_x = 3, dc_f(int a);
+int dc_f(int a) { return a + dc_x; }
+int dc_h(int a), dc_z = 4;
+int dc_h(int a) { return a * dc_z; }
+int *dc_p[3], (*dc_pa)[3], dc_y;
+int (*dc_fp)(int a);
+int dc_local(void) { int a = 1, *b = &a, c[2]; int dc_f(int a); c[1] = dc_f(*b); return c[1]; }
+int dc_proto(void) { int dc_g(int a, int b); return dc_g(2, 3); }
+int dc_g(int a, int b) { return a * b; }
+int dc_first(void) { int dc_h(int a), y = 3; return dc_h(y); }
+int dc_empty(void) { int; struct dc_s { int a; }; struct dc_s s = {9}; return s.a; }
+
 int main() {
   // [62] 修正解析复杂类型声明
   
@@ -26,6 +63,40 @@ int main() {
   ASSERT(8, ({ long int x; sizeof(x); }));
   ASSERT(8, ({ int long x; sizeof(x); }));
 
+  // 顶层声明按结尾的';'或函数体的'}'逐个切分
+  ASSERT(2, cut_s.b);
+  ASSERT(12, sizeof(cut_arr));
+  ASSERT(5, cut_arr[2]);
+  ASSERT(5, cut_call(cut_inc(3), 1));
+  ASSERT(6, cut_a);
+  ASSERT(8, cut_b);
+  ASSERT(11, cut_h());
+  ASSERT(0, strcmp(cut_str, "}{;"));
+  ASSERT(125, cut_ch);
+  ASSERT(12, cut_v.a);
+  ASSERT(14, cut_en);
+  ASSERT(15, cut3v.a);
+  ASSERT(0, cut_d);
+  ASSERT(16, cut_e());
+
+
+  // 每个声明的第一个声明符只解析一次，是函数类型时才是函数
+  ASSERT(3, dc_x);
+  ASSERT(7, dc_f(4));
+  ASSERT(24, sizeof(dc_p));
+  ASSERT(12, sizeof(*dc_pa));
+  ASSERT(0, dc_y);
+  ASSERT(8, sizeof(dc_fp));
+  ASSERT(1, dc_fp == 0);
+  ASSERT(4, dc_local());
+  ASSERT(6, dc_proto());
+  ASSERT(4, dc_z);
+  ASSERT(20, dc_h(5));
+  ASSERT(12, dc_first());
+  ASSERT(9, dc_empty());
+  ASSERT(20, ({ int a = 2, b[4], *c = &a; sizeof(b) + *c + sizeof(c) - 6; }));
+  ASSERT(5, ({ int x = 5, f(int a); x; }));
+
   printf("OK\n");
   return 0;
 }
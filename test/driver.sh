@@ -29,7 +29,62 @@ rm -f $tmp/out
 # 将-o传入check函数
 check -o
 
-# --help
+# 出错时不留下输出文件，即使出错前已经输出了函数
+rm -f $tmp/out*
+echo 'int f() { return 1; } int main() { return 0x; }' > $tmp/err.c
+./rvcc -o $tmp/out $tmp/err.c 2> /dev/null
+[ -z "$(ls $tmp | grep '^out')" ]
+check 'no output on error'
+
+# #error报错，被跳过的#error不报错
+printf '#if 0\n#error skipped\n#endif\nint main() { return 0; }\n' > $tmp/pp.c
+./rvcc -o $tmp/out $tmp/pp.c
+check '#error skipped'
+printf 'int x;\n#error boom\n' > $tmp/pp.c
+! ./rvcc -o $tmp/out $tmp/pp.c 2> $tmp/pp.err && grep -q '#error boom' $tmp/pp.err
+check '#error'
+
+# 常量表达式中除以0报错
+echo 'int x = 1 / 0;' > $tmp/div.c
+! ./rvcc -o $tmp/out $tmp/div.c 2> $tmp/div.err && grep -q 'division by zero' $tmp/div.err
+check 'division by zero'
+printf '#if 1 %% 0\n#endif\n' > $tmp/div.c
+! ./rvcc -o $tmp/out $tmp/div.c 2> $tmp/div.err && grep -q 'division by zero' $tmp/div.err
+check 'division by zero in #if'
+
+# 反斜杠换行连接的行之后，报错的行号不变
+printf '#define A(x) \\\n  (x)\nint x = A(1);\nint y = ;\n' > $tmp/cont.c
+! ./rvcc -o $tmp/out $tmp/cont.c 2> $tmp/cont.err && grep -q 'cont.c:4 int y = ;' $tmp/cont.err
+check 'line numbers after backslash-newline'
+
+# 多线程词法分析的结果与单线程的相同，文件要足够大才会分块
+echo '#define ONE 1' > $tmp/big.c
+for i in $(seq 1 12000); do
+  echo "/* 函数 $i
+   */ int f$i(int x) { // 注释 \"
+  return x + ONE; }
+char *s$i = \"a\\\"b // /* 不是注释\";"
+done >> $tmp/big.c
+./rvcc --lex-threads 1 -o $tmp/big1.s $tmp/big.c &&
+  ./rvcc --lex-threads 4 -o $tmp/big4.s $tmp/big.c &&
+  cmp -s $tmp/big1.s $tmp/big4.s
+check '--lex-threads'
+
+# 结构体和联合体的成员重名报错
+echo 'struct S { int a; long b; char a; };' > $tmp/mem.c
+! ./rvcc -o $tmp/out $tmp/mem.c 2> $tmp/mem.err && grep -q 'duplicate member' $tmp/mem.err
+check 'duplicate struct member'
+echo 'union U { int a; char a; };' > $tmp/mem.c
+! ./rvcc -o $tmp/out $tmp/mem.c 2> $tmp/mem.err && grep -q 'duplicate member' $tmp/mem.err
+check 'duplicate union member'
+
+# 每个节点至多定型一次，长表达式链和深层嵌套的块也一样
+echo "int f(int x) { return x$(printf ' + x%.0s' $(seq 1 3000)); }" > $tmp/deep.c
+echo "int g(int x) { $(printf '{%.0s' $(seq 1 500)) x = ({ int y[2] = {x}; y[0]; }); $(printf '}%.0s' $(seq 1 500)) return x; }" >> $tmp/deep.c
+./rvcc --stats -o $tmp/out $tmp/deep.c 2> $tmp/stats &&
+  awk -F'[:,] *' '{ exit !($2 > 0 && $4 <= $2) }' $tmp/stats
+check '--stats'
+
 # 将--help的结果传入到grep进行 行过滤
 # -q不输出，是否匹配到存在rvcc字符串的行结果
 ./rvcc --help 2>&1 | grep -q rvcc
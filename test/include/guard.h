@@ -0,0 +1,5 @@
+// 有包含守卫，重复包含时跳过
+#ifndef GUARD_H
+#define GUARD_H
++ 1
+#endif
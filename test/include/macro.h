@@ -0,0 +1,3 @@
+// 通过-I找到的头文件，其中的宏和函数在包含之后可用
+#define INC_VAL 42
+int inc_fn(int x) { return x + INC_VAL; }
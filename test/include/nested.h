@@ -0,0 +1,3 @@
+// 头文件中的""包含先在头文件所在目录中查找
+#include "noguard.h"
+#include "noguard.h"
@@ -0,0 +1,2 @@
+// 没有包含守卫，每次包含都展开
++ 1
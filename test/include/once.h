@@ -0,0 +1,3 @@
+// #pragma once，重复包含时跳过
+#pragma once
++ 1
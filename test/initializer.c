@@ -44,6 +44,30 @@ typedef struct {char a, b[];} T65;
 T65 g65 = {'f', 'o', 'o', 0};
 T65 g66 = {'f', 'o', 'o', 'b', 'a', 'r', 0};
 
+// 全局变量初始化器的数据按类型大小分配
+struct {char a; int b; long c;} g70[2] = {{1, 2, 3}, {4}};
+long g71[40] = {1, 2, 3};
+
+// 大部分为0的数组只保存初始化了的元素
+int g72[100000] = {1, 2, 3};
+int *g73[1000] = {0, &g72[2]};
+char g74[1000][4] = {"ab", "cd"};
+struct {int a; struct {char b; int c[4];} d[3]; long e;} g75[4] = {{1, {{2, {3}}, {4}}}, {5}};
+
+// 整数字面量组成的表直接写入数据，其他元素回到常规的初始化
+int g76[6] = {1, 2, 1+2, 4, -(5), 6};
+int g77[3] = {1, 2, 3, 4, 5};
+int g78 = 99;
+char g79[5] = {-1, -128, 127, 200, - 2};
+short g80[3] = {-1, -32768, 40000};
+long g81[4] = {4294967296, -4294967297, 9223372036854775807, -1};
+int g82[2] = {4294967297, -4294967296};
+_Bool g83[3] = {0, 2, -1};
+_Bool g86[3] = {1+1, 2, 0};
+_Bool g87 = 5;
+int g84[] = {1, 2, 3, 2*2};
+int g85[2][3] = {{1, 2, 3}, {4, 5}};
+
 
 int main() {
 
@@ -210,6 +234,84 @@ int main() {
   ASSERT(0, strcmp(g43[0], "foo"));
   ASSERT(0, strcmp(g43[1], "bar"));
 
+  // 全局变量初始化器的数据按类型大小分配
+  ASSERT(32, sizeof(g70));
+  ASSERT(1, g70[0].a);
+  ASSERT(2, g70[0].b);
+  ASSERT(3, g70[0].c);
+  ASSERT(4, g70[1].a);
+  ASSERT(0, g70[1].b);
+  ASSERT(0, g70[1].c);
+  ASSERT(320, sizeof(g71));
+  ASSERT(3, g71[2]);
+  ASSERT(0, g71[20]);
+  ASSERT(0, g71[39]);
+
+  // 大部分为0的数组只保存初始化了的元素
+  ASSERT(1, sizeof(g72) == 400000);
+  ASSERT(1, g72[0]);
+  ASSERT(3, g72[2]);
+  ASSERT(0, g72[3]);
+  ASSERT(0, g72[99999]);
+  ASSERT(0, g73[0] != 0);
+  ASSERT(3, *g73[1]);
+  ASSERT(0, g73[999] != 0);
+  ASSERT(0, strcmp(g74[1], "cd"));
+  ASSERT(0, g74[2][0]);
+  ASSERT(0, g74[999][3]);
+  ASSERT(1, g75[0].a);
+  ASSERT(2, g75[0].d[0].b);
+  ASSERT(3, g75[0].d[0].c[0]);
+  ASSERT(0, g75[0].d[0].c[3]);
+  ASSERT(4, g75[0].d[1].b);
+  ASSERT(0, g75[0].d[1].c[0]);
+  ASSERT(0, g75[0].d[2].b);
+  ASSERT(0, g75[0].e);
+  ASSERT(5, g75[1].a);
+  ASSERT(0, g75[1].d[0].b);
+  ASSERT(0, g75[3].e);
+  ASSERT(3, ({ int x[10000] = {1, 2}; x[0] + x[1] + x[5000] + x[9999]; }));
+  ASSERT(6, ({ struct {int a[3]; char b;} x[5] = {{{1}, 2}, {{3, 4}}}; x[0].a[0] + x[0].a[2] + x[0].b + x[1].a[0] + x[1].b + x[4].a[2]; }));
+
+  // 整数字面量组成的表直接写入数据，其他元素回到常规的初始化
+  ASSERT(3, g76[2]);
+  ASSERT(4, g76[3]);
+  ASSERT(-5, g76[4]);
+  ASSERT(6, g76[5]);
+  ASSERT(12, sizeof(g77));
+  ASSERT(3, g77[2]);
+  ASSERT(99, g78);
+  ASSERT(-1, g79[0]);
+  ASSERT(-128, g79[1]);
+  ASSERT(127, g79[2]);
+  ASSERT(-56, g79[3]);
+  ASSERT(-2, g79[4]);
+  ASSERT(-1, g80[0]);
+  ASSERT(-32768, g80[1]);
+  ASSERT(-25536, g80[2]);
+  ASSERT(1, g81[0] == 4294967296);
+  ASSERT(1, g81[1] == -4294967297);
+  ASSERT(1, g81[2] == 9223372036854775807);
+  ASSERT(-1, g81[3]);
+  ASSERT(1, g82[0]);
+  ASSERT(0, g82[1]);
+  ASSERT(0, g83[0]);
+  ASSERT(1, g83[1]);
+  ASSERT(1, g83[2]);
+  ASSERT(1, g86[0]);
+  ASSERT(1, g86[1]);
+  ASSERT(0, g86[2]);
+  ASSERT(1, g87);
+  ASSERT(16, sizeof(g84));
+  ASSERT(4, g84[3]);
+  ASSERT(5, g85[1][1]);
+  ASSERT(0, g85[1][2]);
+  ASSERT(-56, ({ char x[3] = {-1, 200, 3}; x[1]; }));
+  ASSERT(-25536, ({ short x[2] = {1, 40000}; x[1]; }));
+  ASSERT(1, ({ long x[2] = {1, -4294967297}; x[1] == -4294967297; }));
+  ASSERT(3, ({ int x[3] = {1, 2, 3, 4}; x[2]; }));
+  ASSERT(7, ({ int x[4] = {1, 2 * 3, 7, 8}; x[1] + x[2] - x[0] * 6; }));
+
   printf("OK\n");
   return 0;
 }
@@ -0,0 +1,190 @@
+#include "test.h"
+#include <macro.h>
+
+// 对象宏
+#define M1 3
+#define M2 M1 + 4
+#define EMPTY
+int obj_macro() { return M2 * 2 EMPTY; }
+
+// 函数宏
+#define ADD(a, b) ((a) + (b))
+#define SQ(x) ((x) * (x))
+#define FIVE() 5
+int sum3(int a, int b, int c) { return a * 100 + b * 10 + c; }
+
+// 可变参数宏
+#define FIRST(a, ...) a
+#define SUM3(...) sum3(__VA_ARGS__)
+#define CALL(f, ...) f(__VA_ARGS__)
+
+// #和##
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#define CAT(a, b) a ## b
+#define XCAT(a, b) CAT(a, b)
+int var12 = 12;
+
+// 隐藏集阻止宏的递归展开
+int foo = 5;
+#define foo (foo + 1)
+#define f(a) a*g
+#define g(a) f(a)
+
+// #if和#elif，defined
+#if defined(M1) && !defined NOPE
+int if1 = 1;
+#elif 1
+int if1 = 2;
+#else
+int if1 = 3;
+#endif
+
+#if 0
+int if2 = 1;
+# if 1
+int if2 = 4;
+# endif
+#elif defined M2 && M1 == 3
+int if2 = 2;
+#else
+int if2 = 3;
+#endif
+
+#ifdef NOPE
+int if3 = 1;
+#elif FIVE() - 5
+int if3 = 2;
+#elif ADD(1, 2) == 3 && NOPE == 0
+int if3 = 3;
+#endif
+
+#if __STDC_VERSION__ >= 201112 && defined(__riscv) && __riscv_xlen == 64
+int if5 = 5;
+#endif
+
+#define UNDEF 1
+#undef UNDEF
+#ifndef UNDEF
+int if4 = 4;
+#endif
+
+// 包含守卫和#pragma once使重复包含的头文件被跳过
+int guard_cnt = 0
+#include "guard.h"
+#include "guard.h"
+;
+int once_cnt = 0
+#include "once.h"
+#include "once.h"
+;
+int noguard_cnt = 0
+#include "noguard.h"
+#include "nested.h"
+;
+
+// 指令所在行结束处的EOF不是运算符
+int g1 = 1
+#if 1
+- 1;
+#endif
+
+int g2 = 2
+#if 0
++ 5
+#else
+* 3
+#endif
+;
+
+// 反斜杠换行把两行连成一行
+#define MUL3(a, b, \
+             c) \
+  ((a) * (b) \
+   * (c))
+#if defined(MUL3) && \
+    MUL3(1, 2, 3) == 6
+int cont1 = 1;
+#else
+int cont1 = 2;
+#endif
+int cont_\
+var = 7;
+char *cont_str = "ab\
+cd";
+
+int deref_assign() {
+  int x = 0;
+  int *p = &x;
+#if 1
+  *p = 3;
+#endif
+  return x;
+}
+
+int main() {
+  // 对象宏
+  ASSERT(7, M2);
+  ASSERT(11, obj_macro());
+
+  // 函数宏
+  ASSERT(7, ADD(3, 4));
+  ASSERT(25, SQ(ADD(2, 3)));
+  ASSERT(5, FIVE());
+  ASSERT(10, ADD((1, 2), 8));
+
+  // 可变参数宏
+  ASSERT(1, FIRST(1, 2, 3));
+  ASSERT(1, FIRST(1));
+  ASSERT(123, SUM3(1, 2, 3));
+  ASSERT(456, CALL(sum3, 4, 5, 6));
+
+  // #和##
+  ASSERT(0, strcmp(STR(a + b), "a + b"));
+  ASSERT(0, strcmp(STR( a   +b ), "a +b"));
+  ASSERT(0, strcmp(STR("x\n"), "\"x\\n\""));
+  ASSERT(0, strcmp(XSTR(M1), "3"));
+  ASSERT(0, strcmp(STR(M1), "M1"));
+  ASSERT(12, CAT(var, 12));
+  ASSERT(12, XCAT(var, XCAT(1, 2)));
+  ASSERT(34, CAT(3, 4));
+
+  // 隐藏集阻止宏的递归展开
+  ASSERT(6, foo);
+  int g = 10;
+  ASSERT(180, f(2)(9));
+
+  // #if和#elif，defined
+  ASSERT(1, if1);
+  ASSERT(2, if2);
+  ASSERT(3, if3);
+  ASSERT(4, if4);
+
+  // 内置的预定义宏
+  ASSERT(5, if5);
+  ASSERT(1, __STDC__);
+  ASSERT(8, __SIZEOF_POINTER__ + __SIZEOF_LONG__ - 8);
+
+  // 通过-I包含头文件
+  ASSERT(42, INC_VAL);
+  ASSERT(43, inc_fn(1));
+
+  // 包含守卫和#pragma once使重复包含的头文件被跳过
+  ASSERT(1, guard_cnt);
+  ASSERT(1, once_cnt);
+  ASSERT(3, noguard_cnt);
+
+  // 指令所在行结束处的EOF不是运算符
+  ASSERT(0, g1);
+  ASSERT(6, g2);
+  ASSERT(3, deref_assign());
+
+  // 反斜杠换行把两行连成一行
+  ASSERT(24, MUL3(2, 3, 4));
+  ASSERT(1, cont1);
+  ASSERT(7, cont_var);
+  ASSERT(0, strcmp(cont_str, "abcd"));
+
+  printf("OK\n");
+  return 0;
+}
@@ -1,5 +1,22 @@
 #include "test.h"
 
+// 相同的派生类型共用一个对象，不同的派生类型不能混用
+struct ty_a { int a; };
+struct ty_b { char b; };
+struct ty_a *ty_pa;
+struct ty_b *ty_pb;
+struct ty_c *ty_pc;
+struct ty_c *ty_arr[3];
+struct ty_c { int a[10]; };
+struct ty_c *ty_pc2;
+typedef int ty_open[];
+ty_open ty_o2 = {1, 2};
+ty_open ty_o3 = {1, 2, 3};
+struct ty_e { int a; };
+struct ty_e *ty_po;
+int ty_inner() { struct ty_e { long a[2]; }; struct ty_e *pi; return sizeof(*pi) * 10 + sizeof(*ty_po); }
+int ty_after() { struct ty_e *p; return sizeof(*p); }
+
 int main() {
   // [20] 支持一元& *运算符
   ASSERT(3, ({ int x=3; *&x; }));
@@ -43,6 +60,30 @@ int main() {
   ASSERT(4, ({ int x[2][3]; int *y=x; y[4]=4; x[1][1]; }));
   ASSERT(5, ({ int x[2][3]; int *y=x; y[5]=5; x[1][2]; }));
 
+  // 相同的派生类型共用一个对象，不同的派生类型不能混用
+  ASSERT(4, sizeof(*ty_pa));
+  ASSERT(1, sizeof(*ty_pb));
+  ASSERT(40, sizeof(*ty_pc));
+  ASSERT(40, sizeof(*ty_arr[1]));
+  ASSERT(40, sizeof(*ty_pc2));
+  ASSERT(8, sizeof(ty_o2));
+  ASSERT(12, sizeof(ty_o3));
+  ASSERT(164, ty_inner());
+  ASSERT(4, ty_after());
+  ASSERT(12, ({ int (*p)[3]; sizeof(*p); }));
+  ASSERT(16, ({ int (*p)[4]; sizeof(*p); }));
+  ASSERT(16, ({ int x[2][4]; int (*p)[4] = x; (char *)(p + 1) - (char *)p; }));
+  ASSERT(4, ({ char (*p)[4]; sizeof(*p); }));
+  ASSERT(16, ({ int (*p)[4]; sizeof(*p); }));
+  ASSERT(8, ({ int **p; sizeof(*p); }));
+  ASSERT(4, ({ int **p; sizeof(**p); }));
+  ASSERT(1, ({ char **p; sizeof(**p); }));
+  ASSERT(12, ({ int x[3]; int y[3]; sizeof(x) + sizeof(y) - 12; }));
+  ASSERT(3, ({ int x[3]; char y[3]; sizeof(y); }));
+  ASSERT(4, sizeof((char)1 + (short)2));
+  ASSERT(8, sizeof((long)1 + 1));
+  ASSERT(1, ({ char c = 300; c == 44; }));
+
   printf("OK\n");
   return 0;
 }
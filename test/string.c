@@ -1,5 +1,14 @@
 #include "test.h"
 
+// 相同的字符串字面量在整个文件中共用一个对象
+char* pool_fn() { return "pool"; }
+
+// 字符串字面量输出到只读段之后，全局变量仍在自己的段中对齐
+char al_t[] = "xyz";
+char *al_s = "ab\0cd";
+char al_c;
+long al_l;
+
 int main() {
   // [34] 支持字符串字面量
   ASSERT(0, ""[0]);
@@ -39,6 +48,28 @@ int main() {
   ASSERT(0, "\x00"[0]);
   ASSERT(119, "\x77"[0]);
 
+  // 相同的字符串字面量共用一个对象
+  ASSERT(1, "abc" == "abc");
+  ASSERT(0, "abc" == "abd");
+  ASSERT(0, "ab" == "abc");
+  ASSERT(1, pool_fn() == "pool");
+  ASSERT(0, strcmp(pool_fn(), "pool"));
+
+  // 含有'\0'的字符串字面量按字节输出到.rodata
+  ASSERT(4, sizeof("a\0b"));
+  ASSERT(97, "a\0b"[0]);
+  ASSERT(0, "a\0b"[1]);
+  ASSERT(98, "a\0b"[2]);
+  ASSERT(0, "a\0b"[3]);
+  ASSERT(0, memcmp("x\0y\0", "x\0y", 4));
+  ASSERT(1, "a\0b" == "a\0b");
+  ASSERT(0, "a\0b" == "a\0c");
+
+  // 字符串字面量输出到只读段之后，全局变量仍在自己的段中对齐
+  ASSERT(0, (long)&al_s % 8);
+  ASSERT(0, (long)&al_l % 8);
+  ASSERT(100, al_s[4]);
+
   printf("OK\n");
   return 0;
 }
@@ -1,5 +1,15 @@
 #include "test.h"
 
+// 内层作用域的同名标签遮蔽外层的，离开作用域后恢复
+struct sh_tag { int a; };
+enum sh_e { SH_A = 3 };
+int sh_tag_fn() { struct sh_tag { long a, b; }; return sizeof(struct sh_tag); }
+int sh_tag_after() { return sizeof(struct sh_tag); }
+
+// 成员多的结构体按名字查找成员
+struct big_mem { int m0; int m1; int m2; int m3; int m4; int m5; int m6; int m7; int m8; int m9; int m10; int m11; int m12; int m13; int m14; int m15; int m16; int m17; int m18; int m19; char m20; long m21; short m22; short m23; short m24; short m25; short m26; short m27; short m28; short m29; short m30; short m31; short m32; short m33; short m34; short m35; short m36; short m37; short m38; short m39; };
+struct big_mem big_g = {0, 1, 2, 3};
+
 int main() {
    // [88] 增加不完整结构体的概念
   ASSERT(8, ({ struct foo *bar; sizeof(bar); }));
@@ -66,6 +76,30 @@ int main() {
   ASSERT(8, ({ struct t {int a; int b;} x; struct t y; sizeof(y); }));
   ASSERT(8, ({ struct t {int a; int b;}; struct t y; sizeof(y); }));
 
+  // 内层作用域的同名标签遮蔽外层的，离开作用域后恢复
+  ASSERT(16, sh_tag_fn());
+  ASSERT(4, sh_tag_after());
+  ASSERT(321, ({ struct t {char a;}; int r; { struct t {char a[2];}; { struct t {char a[3];}; r = sizeof(struct t); } r = r * 10 + sizeof(struct t); } r * 10 + sizeof(struct t); }));
+  ASSERT(12, ({ union sh_tag { int a; char b[12]; }; sizeof(union sh_tag); }));
+  ASSERT(4, sizeof(struct sh_tag));
+  ASSERT(5, ({ enum sh_e { SH_B = 5 }; enum sh_e v = SH_B; v; }));
+  ASSERT(3, SH_A);
+  ASSERT(11, ({ struct sh_tag o = {7}; struct sh_tag *p = &o; int r; { struct sh_tag { char c[20]; }; r = p->a + sizeof(*p); } r; }));
+  ASSERT(20, ({ struct sh_tag o; int r; { struct sh_tag { char c[20]; } i; r = sizeof(i); } r; }));
+  ASSERT(23, ({ int r = 0; { struct s2 { char c[2]; }; r = sizeof(struct s2); } { struct s2 { char c[3]; }; r = r * 10 + sizeof(struct s2); } r; }));
+  ASSERT(8, ({ struct sh_tag *p; { struct sh_tag; struct sh_tag { long x; } *q; p = 0; } sizeof(struct sh_tag) * 2; }));
+
+  // 成员多的结构体按名字查找成员
+  ASSERT(136, sizeof(struct big_mem));
+  ASSERT(3, big_g.m3);
+  ASSERT(0, big_g.m39);
+  ASSERT(80, ({ struct big_mem x; (char*)&x.m20 - (char*)&x; }));
+  ASSERT(88, ({ struct big_mem x; (char*)&x.m21 - (char*)&x; }));
+  ASSERT(130, ({ struct big_mem x; (char*)&x.m39 - (char*)&x; }));
+  ASSERT(61, ({ struct big_mem x; x.m0 = 1; x.m19 = 20; x.m21 = 40; x.m39 = -1; x.m0 + x.m19 + x.m21 + x.m39 + 1; }));
+  ASSERT(2, ({ struct big_mem *p = &big_g; p->m2; }));
+  ASSERT(5, ({ struct { int m3; int m39; } y = {5, 6}; y.m3; }));
+
   printf("OK\n");
   return 0;
 }
@@ -2,6 +2,23 @@
 
 int g1, g2[4];
 
+// 内层作用域的同名变量遮蔽外层的变量、函数和typedef
+int g_sh = 10;
+int sh_fn() { return 20; }
+typedef int sh_t;
+int sh_param(int x) { { int x = 5; } return x; }
+int sh_param2(int x) { int r = x; { int x = 7; r = r * 10 + x; } return r * 10 + x; }
+int sh_global() { int g_sh = 1; { int g_sh = 2; } return g_sh; }
+
+// 函数的节点在生成代码后释放，静态局部变量、字符串和类型在函数之后仍然有效
+int *ar_int() { static int x = 5; return &x; }
+int ar_struct() { static struct { int a; char b[3]; long c; } s = {7, "ab", 9}; return s.a + s.b[1] + s.c + sizeof(s); }
+char *ar_str() { return "arena"; }
+char **ar_ptr() { static char *p = "lit"; static char **pp = &p; return pp; }
+int *ar_arr() { static int a[3] = {1, 2, 3}; static int *p = a + 2; return p; }
+int ar_fill() { int a=1, b=2, c=3, d=4, e=5, f=6, g=7, h=8; return ({ int s = a+b+c+d+e+f+g+h; s; }); }
+int ar_after() { static char *s[2] = {"xy", "z"}; return s[0][1] + s[1][0]; }
+
 int main() {
    ASSERT(24, ({ char *x[3]; sizeof(x); }));
   ASSERT(8, ({ char (*x)[3]; sizeof(x); }));
@@ -67,6 +84,31 @@ int main() {
   ASSERT(7, ({ int x; int y; char z; char *a=&y; char *b=&z; b-a; }));
   ASSERT(1, ({ int x; char y; int z; char *a=&y; char *b=&z; b-a; }));
    { void *x; }
+
+  // 内层作用域的同名变量遮蔽外层的变量、函数和typedef
+  ASSERT(10, ({ { int g_sh = 1; } g_sh; }));
+  ASSERT(1, sh_global());
+  ASSERT(10, g_sh);
+  ASSERT(3, sh_param(3));
+  ASSERT(373, sh_param2(3));
+  ASSERT(3, ({ int sh_fn = 3; sh_fn; }));
+  ASSERT(20, sh_fn());
+  ASSERT(4, ({ sh_t x = 1; { int sh_t = 4; x = sh_t; } x; }));
+  ASSERT(4, ({ sh_t y; sizeof(y); }));
+
+  // 函数的节点在生成代码后释放，静态局部变量、字符串和类型在函数之后仍然有效
+  ASSERT(5, *ar_int());
+  ASSERT(130, ar_struct());
+  ASSERT(0, strcmp(ar_str(), "arena"));
+  ASSERT(0, strcmp(*ar_ptr(), "lit"));
+  ASSERT(3, *ar_arr());
+  ASSERT(36, ar_fill());
+  ASSERT(243, ar_after());
+  ASSERT(9, ({ int v = 1, r; { typedef long v; v z; r = sizeof(z); } r + v; }));
+  ASSERT(5, ({ int r = 0; { int a = 2; r = r + a; } { int a = 3; r = r + a; } r; }));
+  ASSERT(321, ({ int x = 1, r = 0; { int x = 2; { int x = 3; r = x; } r = r * 10 + x; } r * 10 + x; }));
+  ASSERT(10, ({ int i = 10; for (int i = 0; i < 3; i++) ; i; }));
+  ASSERT(3, ({ int i = 10, n = 0; for (int i = 0; i < 3; i++) { int i = 5; n++; } n; }));
   printf("OK\n");
   return 0;
 }
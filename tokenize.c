@@ -7,8 +7,64 @@
 #include "rvcc.h"
 
 /*Lexical analysis*/
-static char* currentInput;
-static char* CurrentFilename;
+//file being lexed
+static File* CurrentFile;
+
+//the input and every header it includes, in .file order
+static File** InputFiles;
+static int InputFileCnt;
+
+//the lexing state below is per thread, each thread of tokenizeParallel()
+//lexes its own chunk of CurrentFile
+
+//line of the char tokenize() is looking at
+static _Thread_local int CurrentLineNo;
+
+//line table of CurrentFile while it is being lexed
+static _Thread_local int* LineStarts;
+static _Thread_local int LineCnt;
+static _Thread_local int LineCap;
+
+//flags of the next token
+static _Thread_local bool AtBOL;
+static _Thread_local bool HasSpace;
+
+//a lexing error in a worker thread jumps back here instead of exiting
+static _Thread_local jmp_buf* LexBailout;
+
+static void addLineStart(char* P) {
+    if(LineCnt == LineCap) {
+        LineCap = LineCap ? LineCap * 2 : 1024;
+        LineStarts = realloc(LineStarts, sizeof(int) * LineCap);
+    }
+    LineStarts[LineCnt++] = P - CurrentFile->Contents;
+}
+
+//hand the line table lexed so far to the file
+static void syncLines(void) {
+    CurrentFile->LineStarts = LineStarts;
+    CurrentFile->LineCnt = LineCnt;
+}
+
+//P is the char after '\n'
+static void newLine(char* P) {
+    ++CurrentLineNo;
+    addLineStart(P);
+}
+
+//binary search the last line start of F not after Loc
+static int findLineNo(File* F, char* Loc) {
+    int Off = Loc - F->Contents;
+    int L = 0, R = F->LineCnt - 1;
+    while(L < R) {
+        int Mid = (L + R + 1) / 2;
+        if(F->LineStarts[Mid] <= Off)
+            L = Mid;
+        else
+            R = Mid - 1;
+    }
+    return L + 1;
+}
 
 void error(char* Fmt, ...) {
     va_list VA;
@@ -19,11 +75,9 @@ void error(char* Fmt, ...) {
     exit(1);//Exception
 }
 
-static void __verrorAt(int LineNo, char* Loc, char* Fmt, va_list VA) {
-    char* Line = Loc;
-    //don`t minor than currentInput provide in lower bound
-    while(currentInput < Line && Line[-1] == '\n')
-        Line--;
+//LineNo is the one reported, the text shown is the line of F holding Loc
+static void __verrorAt(File* F, int LineNo, char* Loc, char* Fmt, va_list VA) {
+    char* Line = F->Contents + F->LineStarts[findLineNo(F, Loc) - 1];
     char* End = Loc;
     while(*End != '\n') {
         ++End;
@@ -31,7 +85,7 @@ static void __verrorAt(int LineNo, char* Loc, char* Fmt, va_list VA) {
     
 
     //Indent regist how many character has been output
-    int Indent = fprintf(stderr, "%s:%d ", CurrentFilename, LineNo);
+    int Indent = fprintf(stderr, "%s:%d ", F->Name, LineNo);
 
     fprintf(stderr, "%.*s\n", (int)(End - Line), Line);
 
@@ -44,22 +98,19 @@ static void __verrorAt(int LineNo, char* Loc, char* Fmt, va_list VA) {
 }
 
 void errorAt(char* Loc, char* Fmt, ...) {
+    if(LexBailout)
+        longjmp(*LexBailout, 1);
    
-    //get line number
-    int LineNo = 1;
-    for(char* P = currentInput; P < Loc; ++P) {
-        if(*P == '\n')
-            ++LineNo;
-    }
+    syncLines();
     va_list VA;
     va_start(VA, Fmt);
-    __verrorAt(LineNo, Loc, Fmt, VA);
+    __verrorAt(CurrentFile, findLineNo(CurrentFile, Loc), Loc, Fmt, VA);
     exit(1);
 }
 void errorTok(Token* Tok, char* Fmt, ...) {
     va_list VA;
     va_start(VA, Fmt);
-    __verrorAt(Tok->LineNo, Tok->Pos, Fmt, VA);
+    __verrorAt(Tok->File, Tok->LineNo, Tok->Pos, Fmt, VA);
     exit(1);
 }
 
@@ -71,35 +122,162 @@ static bool startWith(char* str, char* subStr) {
     return strncmp(str, subStr, strlen(subStr)) == 0;
 }
 
-static int readPunct(char* P) {
-    static char* Kw[] = {"<<=", ">>=","==", "!=", ">=", "<=" ,"->", "+=", 
-                         "-=", "*=", "/=","++", "--", "%=", "&=", "|=", "^=", 
-                         "&&", "||", "<<", ">>"};
-    for(int i = 0; i < sizeof(Kw) / sizeof(*Kw); ++i) {
-        if(startWith(P, Kw[i]))
-            return strlen(Kw[i]);
-    }
-    return ispunct(*P) ? 1 : 0;
-}
-
-static bool isKeyWord(Token* Tok) {
-    static char* Kw[] = {"return", "if", "else", "for" ,"while", "int", "long", "short",
-                         "sizeof", "char", "struct", "union", "void", "typedef", "_Bool", 
-                         "enum", "static", "goto", "break", "continue", "switch", "break", 
-                         "default", "extern"};
-    for(int i = 0; i < sizeof(Kw) / sizeof(*Kw); i++) {
-        if(equal(Tok, Kw[i]))
-            return true;
+// pick the longest punctuator by its first char, at most 3 byte compares
+static int readPunct(char* P, PunctKind* Kind) {
+    switch(*P) {
+        case '<':
+        case '>': {
+            bool Less = *P == '<';
+            if(P[1] == *P) {
+                if(P[2] == '=') {
+                    *Kind = Less ? PT_SHL_ASSIGN : PT_SHR_ASSIGN;
+                    return 3;
+                }
+                *Kind = Less ? PT_SHL : PT_SHR;
+                return 2;
+            }
+            if(P[1] == '=') {
+                *Kind = Less ? PT_LE : PT_GE;
+                return 2;
+            }
+            break;
+        }
+        case '=':
+            if(P[1] == '=') {
+                *Kind = PT_EQ;
+                return 2;
+            }
+            break;
+        case '!':
+            if(P[1] == '=') {
+                *Kind = PT_NE;
+                return 2;
+            }
+            break;
+        case '-':
+            if(P[1] == '>') {
+                *Kind = PT_ARROW;
+                return 2;
+            }
+            if(P[1] == '-') {
+                *Kind = PT_DEC;
+                return 2;
+            }
+            if(P[1] == '=') {
+                *Kind = PT_SUB_ASSIGN;
+                return 2;
+            }
+            break;
+        case '+':
+            if(P[1] == '+') {
+                *Kind = PT_INC;
+                return 2;
+            }
+            if(P[1] == '=') {
+                *Kind = PT_ADD_ASSIGN;
+                return 2;
+            }
+            break;
+        case '&':
+            if(P[1] == '&') {
+                *Kind = PT_LOGAND;
+                return 2;
+            }
+            if(P[1] == '=') {
+                *Kind = PT_AND_ASSIGN;
+                return 2;
+            }
+            break;
+        case '|':
+            if(P[1] == '|') {
+                *Kind = PT_LOGOR;
+                return 2;
+            }
+            if(P[1] == '=') {
+                *Kind = PT_OR_ASSIGN;
+                return 2;
+            }
+            break;
+        case '#':
+            if(P[1] == '#') {
+                *Kind = PT_HASHHASH;
+                return 2;
+            }
+            break;
+        case '.':
+            if(P[1] == '.' && P[2] == '.') {
+                *Kind = PT_ELLIPSIS;
+                return 3;
+            }
+            break;
+        case '*':
+        case '/':
+        case '%':
+        case '^':
+            if(P[1] == '=') {
+                *Kind = *P == '*' ? PT_MUL_ASSIGN :
+                        *P == '/' ? PT_DIV_ASSIGN :
+                        *P == '%' ? PT_MOD_ASSIGN : PT_XOR_ASSIGN;
+                return 2;
+            }
+            break;
     }
-    return false;
+    if(!ispunct(*P))
+        return 0;
+    *Kind = *P;
+    return 1;
 }
 
-static void convertKeywords (Token* Tok) {
-    for(Token* Cur = Tok; Cur->Kind != TK_EOF; Cur = Cur->Next) {
-        if(isKeyWord(Cur)) {
-            Cur->Kind = TK_KEYWORD;
-        }
+// dispatch on length and leading chars, so one memcmp decides the keyword
+static bool isKeyword(char* P, int Len) {
+    char* Kw = NULL;
+    switch(Len) {
+        case 2:
+            Kw = "if";
+            break;
+        case 3:
+            Kw = P[0] == 'f' ? "for" : "int";
+            break;
+        case 4:
+            switch(P[0]) {
+                case 'e': Kw = P[1] == 'l' ? "else" : "enum"; break;
+                case 'l': Kw = "long"; break;
+                case 'c': Kw = "char"; break;
+                case 'v': Kw = "void"; break;
+                case 'g': Kw = "goto"; break;
+            }
+            break;
+        case 5:
+            switch(P[0]) {
+                case 'w': Kw = "while"; break;
+                case 's': Kw = "short"; break;
+                case 'u': Kw = "union"; break;
+                case '_': Kw = "_Bool"; break;
+                case 'b': Kw = "break"; break;
+            }
+            break;
+        case 6:
+            switch(P[0]) {
+                case 'r': Kw = "return"; break;
+                case 'e': Kw = "extern"; break;
+                case 's':
+                    if(P[1] == 'i')
+                        Kw = "sizeof";
+                    else if(P[1] == 'w')
+                        Kw = "switch";
+                    else
+                        Kw = P[2] == 'r' ? "struct" : "static";
+                    break;
+            }
+            break;
+        case 7:
+            Kw = P[0] == 't' ? "typedef" : "default";
+            break;
+        case 8:
+            Kw = "continue";
+            break;
     }
+    return Kw && !memcmp(P, Kw, Len);
 }
 
 Token* skip(Token* Tok, char* str) {
@@ -118,21 +296,92 @@ bool consume(Token** Rest, Token* Tok, char* Str) {
 }
 
 
+//tokens are bump allocated from chunks, so neighbours in the list are
+//neighbours in memory too
+#define TOKEN_CHUNK 4096
+
+static _Thread_local Token** TokChunks;
+static _Thread_local int ChunkCnt;
+static _Thread_local int CurChunk = -1;
+static _Thread_local int Used = TOKEN_CHUNK;
+
+//where the tokens of the current top level declaration begin
+static _Thread_local int DeclChunk = -1;
+static _Thread_local int DeclUsed = TOKEN_CHUNK;
+
+//macro bodies and headers live as long as the preprocessor does, they are
+//allocated from chunks of their own which are never recycled
+static bool KeepTokens;
+static Token* KeptChunk;
+static int KeptUsed = TOKEN_CHUNK;
+
+void keepTokens(bool Keep) {
+    KeepTokens = Keep;
+}
+
+static Token* allocToken(void) {
+    if(KeepTokens) {
+        if(KeptUsed == TOKEN_CHUNK) {
+            KeptChunk = malloc(sizeof(Token) * TOKEN_CHUNK);
+            KeptUsed = 0;
+        }
+        Token* Tok = &KeptChunk[KeptUsed++];
+        memset(Tok, 0, sizeof(Token));
+        return Tok;
+    }
+
+    if(Used == TOKEN_CHUNK) {
+        if(++CurChunk == ChunkCnt) {
+            TokChunks = realloc(TokChunks, sizeof(Token*) * (ChunkCnt + 1));
+            TokChunks[ChunkCnt++] = malloc(sizeof(Token) * TOKEN_CHUNK);
+        }
+        Used = 0;
+    }
+    //chunks are reused after a rewind
+    Token* Tok = &TokChunks[CurChunk][Used++];
+    memset(Tok, 0, sizeof(Token));
+    return Tok;
+}
+
 static Token* genToken(TokenKind Kind, char* Start, char* End) {
-    Token* Tok = calloc(1, sizeof(Token));
+    Token* Tok = allocToken();
     Tok->Kind = Kind;
     Tok->Pos = Start;
     Tok->Len = End - Start;
+    Tok->LineNo = CurrentLineNo;
+    Tok->File = CurrentFile;
+    Tok->AtBOL = AtBOL;
+    Tok->HasSpace = HasSpace;
+    AtBOL = HasSpace = false;
     return Tok;
 }
 
+Token* copyToken(Token* Tok) {
+    Token* T = allocToken();
+    *T = *Tok;
+    T->Next = NULL;
+    return T;
+}
+
+//an end of input placed at Tok
+Token* newEOF(Token* Tok) {
+    Token* T = copyToken(Tok);
+    T->Kind = TK_EOF;
+    T->Punct = PT_NONE;
+    T->Len = 0;
+    return T;
+}
+
 static bool isIdent1(char C) {
     return ('a' <= C && C <= 'z') || ('A' <= C && C <= 'Z') || (C == '_');
 } 
 
+//only the scalar skipIdent() needs it
+#ifndef __SSE2__
 static bool isIdent2(char C) {
     return isIdent1(C) || ('0' <= C && C <= '9');
 }
+#endif
 
 static int fromHex(char* C){
     if('0' <= *C && *C <= '9')
@@ -264,96 +513,577 @@ static Token* readIntLiteral(char* Start) {
     return Tok;
 }
 
-void addLineNumber(Token* Tok) {
-    char* P = currentInput;
-    int N = 1;
-    do{
-        if(P == Tok->Pos) {
-            Tok->LineNo = N;
-            Tok = Tok->Next;
+// scanning kernels for the hot loops of tokenize()
+// with SSE2 they look at an aligned 16 byte block at once, an aligned load
+// never crosses a page, so reading up to the block holding '\0' is safe
+#ifdef __SSE2__
+typedef __m128i Block;
+
+static Block loadBlock(char* Blk) {
+    return _mm_load_si128((Block*)Blk);
+}
+
+//bit I set if byte I of V equals C
+static unsigned matchChar(Block V, char C) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(V, _mm_set1_epi8(C)));
+}
+
+//bit I set if Lo <= byte I <= Hi, bytes >= 0x80 are negative and never match
+static unsigned matchRange(Block V, char Lo, char Hi) {
+    Block Ge = _mm_cmpgt_epi8(V, _mm_set1_epi8(Lo - 1));
+    Block Le = _mm_cmplt_epi8(V, _mm_set1_epi8(Hi + 1));
+    return _mm_movemask_epi8(_mm_and_si128(Ge, Le));
+}
+
+static unsigned matchSpace(Block V) {
+    //'\t' '\n' '\v' '\f' '\r' are contiguous
+    return matchChar(V, ' ') | matchRange(V, '\t', '\r');
+}
+
+static unsigned matchIdent(Block V) {
+    return matchRange(V, 'a', 'z') | matchRange(V, 'A', 'Z') |
+           matchRange(V, '0', '9') | matchChar(V, '_');
+}
+
+//report every '\n' flagged in NL of the block
+static void newLines(char* Blk, unsigned NL) {
+    for(; NL; NL &= NL - 1)
+        newLine(Blk + __builtin_ctz(NL) + 1);
+}
+#endif
+
+//skip a whitespace run, return the first non space char
+static char* skipSpaces(char* P) {
+#ifdef __SSE2__
+    char* Blk = (char*)((uintptr_t)P & ~(uintptr_t)15);
+    unsigned Live = (0xFFFF << (P - Blk)) & 0xFFFF;
+    while(1) {
+        Block V = loadBlock(Blk);
+        unsigned Stop = ~matchSpace(V) & Live;
+        unsigned NL = matchChar(V, '\n') & Live;
+        if(Stop) {
+            int I = __builtin_ctz(Stop);
+            newLines(Blk, NL & ((1u << I) - 1));
+            return Blk + I;
         }
-        if(*P == '\n') {
-            ++N;
+        newLines(Blk, NL);
+        Blk += 16;
+        Live = 0xFFFF;
+    }
+#else
+    for(; isspace(*P); ++P) {
+        if(*P == '\n')
+            newLine(P + 1);
+    }
+    return P;
+#endif
+}
+
+//return the first char after the identifier chars
+static char* skipIdent(char* P) {
+#ifdef __SSE2__
+    char* Blk = (char*)((uintptr_t)P & ~(uintptr_t)15);
+    unsigned Live = (0xFFFF << (P - Blk)) & 0xFFFF;
+    while(1) {
+        unsigned Stop = ~matchIdent(loadBlock(Blk)) & Live;
+        if(Stop)
+            return Blk + __builtin_ctz(Stop);
+        Blk += 16;
+        Live = 0xFFFF;
+    }
+#else
+    while(isIdent2(*P))
+        ++P;
+    return P;
+#endif
+}
+
+//return the '\n' ending the line
+static char* skipLine(char* P) {
+#ifdef __SSE2__
+    char* Blk = (char*)((uintptr_t)P & ~(uintptr_t)15);
+    unsigned Live = (0xFFFF << (P - Blk)) & 0xFFFF;
+    while(1) {
+        Block V = loadBlock(Blk);
+        unsigned Stop = (matchChar(V, '\n') | matchChar(V, '\0')) & Live;
+        if(Stop)
+            return Blk + __builtin_ctz(Stop);
+        Blk += 16;
+        Live = 0xFFFF;
+    }
+#else
+    while(*P != '\n' && *P != '\0')
+        ++P;
+    return P;
+#endif
+}
+
+//return the "*/" closing the comment or the ending '\0', counting lines
+static char* skipBlockComment(char* P) {
+#ifdef __SSE2__
+    char* Blk = (char*)((uintptr_t)P & ~(uintptr_t)15);
+    unsigned Live = (0xFFFF << (P - Blk)) & 0xFFFF;
+    while(1) {
+        Block V = loadBlock(Blk);
+        unsigned Hit = (matchChar(V, '*') | matchChar(V, '\n') | matchChar(V, '\0')) & Live;
+        for(; Hit; Hit &= Hit - 1) {
+            char* Q = Blk + __builtin_ctz(Hit);
+            if(*Q == '\n')
+                newLine(Q + 1);
+            else if(*Q == '\0' || Q[1] == '/')
+                return Q;
         }
-    } while(*P++);
+        Blk += 16;
+        Live = 0xFFFF;
+    }
+#else
+    for(; *P && !(P[0] == '*' && P[1] == '/'); ++P) {
+        if(*P == '\n')
+            newLine(P + 1);
+    }
+    return P;
+#endif
+}
+
+//where tokenizeMore() goes on lexing
+static char* CurrentPos;
+
+//tokens lexed ahead by tokenizeParallel(), handed out one declaration at a time
+static Token* PreLexed;
+
+//a top level declaration ends with a ';' outside any bracket or with the '}'
+//closing a function body
+typedef struct {
+    int Depth;
+    bool InBody;
+} DeclEnd;
+
+static bool endsDecl(DeclEnd* D, Token* Prev, Token* Tok) {
+    if(Tok->Kind != TK_PUNCT)
+        return false;
+    PunctKind Punct = Tok->Punct;
+    if(Punct == '(' || Punct == '[' || Punct == '{') {
+        //"f(...) {" at top level opens a function body
+        if(Punct == '{' && D->Depth == 0 && Prev->Kind == TK_PUNCT && Prev->Punct == ')')
+            D->InBody = true;
+        ++D->Depth;
+    }else if(Punct == ')' || Punct == ']' || Punct == '}') {
+        --D->Depth;
+    }
+    return D->Depth == 0 && (Punct == ';' || (Punct == '}' && D->InBody));
+}
+
+//the preprocessor reads its input a part at a time, a part ends with a top
+//level declaration or a directive line and never splits a directive line
+typedef struct {
+    DeclEnd D;
+    bool InDirective;   //in a line starting with '#'
+} PartEnd;
+
+//Tok was just added after Prev, true if the part ends with it
+static bool endsPart(PartEnd* PE, Token* Prev, Token* Tok) {
+    if(Tok->AtBOL)
+        PE->InDirective = Tok->Kind == TK_PUNCT && Tok->Punct == '#';
+    return !PE->InDirective && endsDecl(&PE->D, Prev, Tok);
 }
 
-Token* tokenize(char* Filename, char* P) {
-   CurrentFilename = Filename;
-   currentInput = P;
+//lex from *Pos up to End, or only one part if OnePart
+//the list ends with a TK_EOF, which only is the real end of input when it is
+//the single token returned, *Last gets the token before it
+static Token* lex(char** Pos, char* End, bool OnePart, Token** Last) {
+   char* P = *Pos;
    Token Head = {};
    Token* cur = &Head;
-   while(*P != '\0') {
+   PartEnd PE = {};
+   while(*P != '\0' && P != End) {
+       if(OnePart && PE.InDirective && AtBOL)
+           break;
+
        if(isspace(*P)) {
-            ++P;
+            int LineNo = CurrentLineNo;
+            P = skipSpaces(P);
+            HasSpace = true;
+            AtBOL |= CurrentLineNo != LineNo;
             continue;
        }
      
        if(startWith(P, "//")){
-            P += 2;
-            while(*P != '\n')
-                ++P;
+            P = skipLine(P + 2);
+            HasSpace = true;
             continue;
        }
 
        if(startWith(P, "/*")){
-            char* Q = strstr(P + 2, "*/");
-            if(!Q)
+            char* Q = skipBlockComment(P + 2);
+            if(!*Q)
                 errorAt(P, "unclosed block comment");
             P = Q + 2;
+            HasSpace = true;
             continue;
        }
       
-
+       Token* Tok;
        if(isdigit(*P)) {
-            cur->Next = readIntLiteral(P);
-            cur = cur->Next;
-            P += cur->Len;
-            continue;
-       }
-
-       if(*P == '\'') {
-          cur->Next = readCharLiteral(P);
-          cur = cur->Next;
-          P += cur->Len;
-          continue;
-       }
-
-       
-       if(isIdent1(*P)) {
+            Tok = readIntLiteral(P);
+            P += Tok->Len;
+       }else if(*P == '\'') {
+            Tok = readCharLiteral(P);
+            P += Tok->Len;
+       }else if(isIdent1(*P)) {
            char* dst = P;
-           do{
-               ++P;
-           }while(isIdent2(*P));
-           cur->Next = genToken(TK_IDENT, dst, P);
-           cur = cur->Next;
-           continue;
-       }
-       if(*P == '"') {
-            cur->Next = readStringLiteral(P);
-            cur = cur->Next;
-            P += cur->Len;
-            continue;
-       }
-       int punctLen = readPunct(P);
-       if(punctLen) {
-            cur->Next = genToken(TK_PUNCT, P, P + punctLen);
-            cur = cur->Next;
+           P = skipIdent(P + 1);
+           if(isKeyword(dst, P - dst)) {
+               Tok = genToken(TK_KEYWORD, dst, P);
+           }else {
+               Tok = genToken(TK_IDENT, dst, P);
+               Tok->Ident = intern(dst, P - dst);
+           }
+       }else if(*P == '"') {
+            Tok = readStringLiteral(P);
+            P += Tok->Len;
+       }else {
+            PunctKind Punct;
+            int punctLen = readPunct(P, &Punct);
+            if(!punctLen)
+                errorAt(P, "invalid Token");
+            Tok = genToken(TK_PUNCT, P, P + punctLen);
+            Tok->Punct = Punct;
             P += punctLen;
-            continue;
        }
-       
-       errorAt(P, "invalid Token");
-               
-       error("unexpected character %s", P);
+
+       Token* Prev = cur;
+       cur->Next = Tok;
+       cur = cur->Next;
+       if(OnePart && endsPart(&PE, Prev, cur))
+           break;
    }
    
+   *Last = cur == &Head ? NULL : cur;
+   //the flags belong to the first token of the next part
+   bool BOL = AtBOL, Space = HasSpace;
    cur->Next = genToken(TK_EOF, P, P);
-   addLineNumber(Head.Next);
-   convertKeywords(Head.Next); 
+   AtBOL = BOL;
+   HasSpace = Space;
+   *Pos = P;
+   return Head.Next;
+}
+
+//lex the next part of the input file, a single TK_EOF at its end
+Token* tokenizeMore(void) {
+   Token* Last;
+   Token* Tok = lex(&CurrentPos, NULL, true, &Last);
+   syncLines();
+   return Tok;
+}
+
+//copy the next part of a whole lexed list, *Rest gets the token after it
+Token* copyPart(Token** Rest, Token* Tok) {
+   Token Head = {};
+   Token* Cur = &Head;
+   PartEnd PE = {};
+   while(Tok->Kind != TK_EOF && !(PE.InDirective && Tok->AtBOL)) {
+       Token* Prev = Cur;
+       Cur->Next = copyToken(Tok);
+       Cur = Cur->Next;
+       Tok = Tok->Next;
+       if(endsPart(&PE, Prev, Cur))
+           break;
+   }
+   Cur->Next = newEOF(Tok);
+   *Rest = Tok;
+   return Head.Next;
+}
+
+//cut the next declaration off the pre lexed list
+static Token* cutDecl(void) {
+   Token* Tok = PreLexed;
+   if(Tok->Kind == TK_EOF)
+       return Tok;
+
+   DeclEnd D = {};
+   Token* Prev = Tok;
+   for(; Tok->Next->Kind != TK_EOF; Prev = Tok, Tok = Tok->Next) {
+       if(endsDecl(&D, Prev, Tok))
+           break;
+   }
+   Token* Head = PreLexed;
+   PreLexed = Tok->Next;
+   Tok->Next = newEOF(PreLexed);
+   return Head;
+}
+
+//the pending tokens from Tok up to the TK_EOF ending them outlive the
+//declaration before, they are moved to where the tokens of the next one
+//begin and *End gets their TK_EOF
+static Token* PendingBuf;
+static int PendingCap;
+
+Token* recycleTokens(Token* Tok, Token** End) {
+   int N = 0;
+   for(Token* T = Tok; ; T = T->Next) {
+       if(N == PendingCap) {
+           PendingCap = PendingCap ? PendingCap * 2 : 256;
+           PendingBuf = realloc(PendingBuf, sizeof(Token) * PendingCap);
+       }
+       PendingBuf[N++] = *T;
+       if(T->Kind == TK_EOF)
+           break;
+   }
+
+   //nothing points into the last declaration any more, reuse its tokens
+   CurChunk = DeclChunk;
+   Used = DeclUsed;
+
+   Token Head = {};
+   Token* Cur = &Head;
+   for(int I = 0; I < N; ++I) {
+       Cur->Next = allocToken();
+       Cur = Cur->Next;
+       *Cur = PendingBuf[I];
+   }
+   Cur->Next = NULL;
+   *End = Cur;
+   return Head.Next;
+}
+
+//the next declaration out of the preprocessor, the list handed out before
+//is dead by then
+static Token* readDecl(void) {
+   recycleInput();
+
+   Token Head = {};
+   Token* Cur = &Head;
+   DeclEnd D = {};
+   while(1) {
+       Token* Tok = preprocessToken();
+       Token* Prev = Cur;
+       Cur->Next = Tok;
+       Cur = Cur->Next;
+       if(Tok->Kind == TK_EOF)
+           break;
+       if(endsDecl(&D, Prev, Tok)) {
+           Cur->Next = newEOF(Tok);
+           break;
+       }
+   }
    return Head.Next;
 }
 
+//start lexing F from its first line
+static void beginFile(File* F) {
+   CurrentFile = F;
+   CurrentLineNo = 1;
+   LineStarts = NULL;
+   LineCnt = LineCap = 0;
+   AtBOL = true;
+   HasSpace = false;
+   addLineStart(F->Contents);
+}
+
+//lexing state of a file, the input's is put aside while a header or a
+//fragment is lexed in the middle of it
+typedef struct {
+    File* File;
+    int LineNo;
+    int* LineStarts;
+    int LineCnt;
+    int LineCap;
+    bool AtBOL;
+    bool HasSpace;
+} LexState;
+
+static LexState saveLex(void) {
+    return (LexState){CurrentFile, CurrentLineNo, LineStarts, LineCnt, LineCap, AtBOL, HasSpace};
+}
+
+static void restoreLex(LexState* S) {
+    CurrentFile = S->File;
+    CurrentLineNo = S->LineNo;
+    LineStarts = S->LineStarts;
+    LineCnt = S->LineCnt;
+    LineCap = S->LineCap;
+    AtBOL = S->AtBOL;
+    HasSpace = S->HasSpace;
+}
+
+Token* tokenizeDecl(void) {
+   if(PreLexed)
+       return cutDecl();
+   return readDecl();
+}
+
+//each thread lexes at least this much
+#define LEX_CHUNK_MIN (256 * 1024)
+
+typedef struct {
+    char* Start;
+    char* End;
+    Token* Head;        //tokens of the chunk, ending with a TK_EOF
+    Token* Last;        //last real token, NULL if none
+    int* LineStarts;
+    int LineCnt;
+    bool Failed;
+} LexChunk;
+
+//skip a char or string literal, stopping at the end of line for bad ones
+static char* skipQuoted(char* P) {
+    char Quote = *P++;
+    for(; *P && *P != Quote && *P != '\n'; ++P) {
+        if(*P == '\\' && P[1])
+            ++P;
+    }
+    return *P == Quote ? P + 1 : P;
+}
+
+//find a line start at or after Target which no comment or literal spans,
+//moved on to the next non space char, so no token crosses it
+//the scan goes on from *Scan, which is known to be outside any of them
+static char* findSplit(char** Scan, char* Target) {
+    char* P = *Scan;
+    while(*P) {
+        if(P[0] == '/' && P[1] == '*') {
+            char* Q = strstr(P + 2, "*/");
+            P = Q ? Q + 2 : P + strlen(P);
+            continue;
+        }
+        if(P[0] == '/' && P[1] == '/') {
+            P = skipLine(P + 2);
+            continue;
+        }
+        if(*P == '"' || *P == '\'') {
+            P = skipQuoted(P);
+            continue;
+        }
+        if(*P++ == '\n' && P > Target) {
+            while(isspace(*P))
+                ++P;
+            break;
+        }
+    }
+    *Scan = P;
+    return P;
+}
+
+static void* lexChunk(void* Arg) {
+    LexChunk* C = Arg;
+
+    //the first chunk starts at line 1, the others count lines from 0 and
+    //are shifted once the line counts of the chunks before them are known
+    CurrentLineNo = C->Start == CurrentFile->Contents ? 1 : 0;
+    if(CurrentLineNo)
+        addLineStart(C->Start);
+    //a chunk starts on a fresh line
+    AtBOL = true;
+
+    jmp_buf Bailout;
+    if(setjmp(Bailout)) {
+        C->Failed = true;
+        return NULL;
+    }
+    LexBailout = &Bailout;
+
+    char* P = C->Start;
+    C->Head = lex(&P, C->End, false, &C->Last);
+    C->LineStarts = LineStarts;
+    C->LineCnt = LineCnt;
+    return NULL;
+}
+
+//lex F on up to Threads threads and stitch the chunks, returns NULL
+//if it is not worth it or a chunk has an error, which the serial lexer reports
+static Token* tokenizeParallel(File* F, int Threads) {
+    char* Buf = F->Contents;
+    size_t Size = strlen(Buf);
+    int N = MIN((size_t)Threads, Size / LEX_CHUNK_MIN);
+    if(N < 2)
+        return NULL;
+
+    CurrentFile = F;
+    LineStarts = NULL;
+    LineCnt = LineCap = 0;
+
+    LexChunk* Chunks = calloc(N, sizeof(LexChunk));
+    char* Scan = Buf;
+    char* Start = Buf;
+    int Cnt = 0;
+    for(int I = 1; I <= N; ++I) {
+        char* End = I == N ? Buf + Size : findSplit(&Scan, Buf + Size * I / N);
+        if(End == Start)
+            continue;
+        Chunks[Cnt].Start = Start;
+        Chunks[Cnt].End = End;
+        ++Cnt;
+        Start = End;
+    }
+
+    pthread_t* Tids = calloc(Cnt, sizeof(pthread_t));
+    for(int I = 1; I < Cnt; ++I)
+        pthread_create(&Tids[I], NULL, lexChunk, &Chunks[I]);
+    lexChunk(&Chunks[0]);
+    LexBailout = NULL;
+    for(int I = 1; I < Cnt; ++I)
+        pthread_join(Tids[I], NULL);
+
+    for(int I = 0; I < Cnt; ++I) {
+        if(Chunks[I].Failed)
+            return NULL;
+    }
+
+    //stitch the token lists and line tables, shifting the line numbers
+    Token Head = {};
+    Token* Cur = &Head;
+    int Base = 0;
+    LineStarts = NULL;
+    LineCnt = LineCap = 0;
+    for(int I = 0; I < Cnt; ++I) {
+        LexChunk* C = &Chunks[I];
+        if(C->Last) {
+            Cur->Next = C->Head;
+            for(Token* Tok = C->Head; Tok != C->Last->Next; Tok = Tok->Next)
+                Tok->LineNo += Base;
+            Cur = C->Last;
+        }
+        for(int J = 0; J < C->LineCnt; ++J)
+            addLineStart(Buf + C->LineStarts[J]);
+        Base += C->LineCnt;
+    }
+    CurrentLineNo = Base;
+    Cur->Next = genToken(TK_EOF, Buf + Size, Buf + Size);
+    syncLines();
+    return Head.Next;
+}
+
+// map a regular file directly, the tail of the last page is zero filled by
+// the kernel, so the "\n\0" sentinel the tokenizer relies on fits there for free
+static char* mapFile(FILE* FP) {
+    struct stat St;
+    if(fstat(fileno(FP), &St) != 0 || !S_ISREG(St.st_mode) || St.st_size == 0)
+        return NULL;
+
+    size_t Size = St.st_size;
+    size_t PageSize = sysconf(_SC_PAGESIZE);
+    size_t Slack = (Size + PageSize - 1) / PageSize * PageSize - Size;
+
+    // no room left for the sentinel in the last page
+    if(Slack == 0)
+        return NULL;
+
+    char* Buf = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(FP), 0);
+    if(Buf == MAP_FAILED)
+        return NULL;
+
+    if(Buf[Size - 1] == '\n')
+        return Buf;
+
+    if(Slack < 2) {
+        munmap(Buf, Size);
+        return NULL;
+    }
+    //only the last page is copied on write
+    Buf[Size] = '\n';
+    return Buf;
+}
+
 char* readFile(char* Path) {
     FILE* FP;
 
@@ -366,6 +1096,15 @@ char* readFile(char* Path) {
             error("can`t open %s: %s", Path, strerror(errno));
     }
 
+    //regular file, skip the copy
+    if(FP != stdin) {
+        char* Buf = mapFile(FP);
+        if(Buf) {
+            fclose(FP);
+            return Buf;
+        }
+    }
+
     //prepare Buffer
     char* Buf;
     size_t BufLen;
@@ -391,6 +1130,117 @@ char* readFile(char* Path) {
     return Buf;
 }
 
-Token* tokenizeFile(char* Path) {
-    return tokenize(Path, readFile(Path));
+static File* newFile(char* Name, int FileNo, char* Contents) {
+    File* F = calloc(1, sizeof(File));
+    F->Name = Name;
+    F->FileNo = FileNo;
+    F->Contents = Contents;
+    return F;
+}
+
+//a backslash-newline is taken out before lexing, so lex() never sees it
+//between tokens, inside identifiers and literals or on a directive line
+//the newlines taken out are put back where the joined line ends, the
+//lines after it keep their numbers and their line starts
+static void joinLines(char* P) {
+    //most files have none, leave their pages untouched
+    for(P = strchr(P, '\\'); P && P[1] != '\n'; P = strchr(P + 1, '\\'))
+        ;
+    if(!P)
+        return;
+
+    char* Q = P;
+    int N = 0;
+    while(*P) {
+        if(P[0] == '\\' && P[1] == '\n') {
+            P += 2;
+            ++N;
+        }else if(*P == '\n') {
+            *Q++ = *P++;
+            for(; N > 0; --N)
+                *Q++ = '\n';
+        }else {
+            *Q++ = *P++;
+        }
+    }
+    for(; N > 0; --N)
+        *Q++ = '\n';
+    *Q = '\0';
+}
+
+//a file which gets its own .file number
+static File* addInputFile(char* Path) {
+    char* Contents = readFile(Path);
+    joinLines(Contents);
+    File* F = newFile(Path, InputFileCnt + 1, Contents);
+    InputFiles = realloc(InputFiles, sizeof(File*) * (InputFileCnt + 2));
+    InputFiles[InputFileCnt++] = F;
+    InputFiles[InputFileCnt] = NULL;
+    return F;
+}
+
+File** getInputFiles(void) {
+    return InputFiles;
+}
+
+//lex the whole of F at once
+static Token* lexFile(File* F, int Threads) {
+    if(Threads > 1) {
+        Token* Tok = tokenizeParallel(F, Threads);
+        if(Tok)
+            return Tok;
+    }
+    beginFile(F);
+    char* P = F->Contents;
+    Token* Last;
+    Token* Tok = lex(&P, NULL, false, &Last);
+    syncLines();
+    return Tok;
+}
+
+//a header is lexed whole and kept, a later #include of it copies its tokens
+Token* tokenizeInclude(char* Path) {
+    LexState S = saveLex();
+    keepTokens(true);
+    Token* Tok = lexFile(addInputFile(Path), 1);
+    keepTokens(false);
+    restoreLex(&S);
+    return Tok;
+}
+
+//lex a token made up by the preprocessor, it is placed where Origin is
+Token* tokenizeFragment(char* Buf, Token* Origin) {
+    //whole 16 byte blocks, the scanning kernels read the block holding '\0'
+    int Len = strlen(Buf);
+    char* Contents = calloc(1, (Len + 2 + 15) & ~15);
+    memcpy(Contents, Buf, Len);
+    Contents[Len] = '\n';
+
+    File* F = newFile(Origin->File->Name, Origin->File->FileNo, Contents);
+    LexState S = saveLex();
+    Token* Tok = lexFile(F, 1);
+    restoreLex(&S);
+    for(Token* T = Tok; T; T = T->Next)
+        T->LineNo = Origin->LineNo;
+    return Tok;
+}
+
+Token* tokenizeFile(char* Path, int Threads) {
+    File* F = addInputFile(Path);
+    defineBuiltinMacros(&(Token){.File = F, .LineNo = 1});
+
+    //lexing on threads wants the whole file at once
+    if(Threads > 1) {
+        PreLexed = preprocess(lexFile(F, Threads));
+        return cutDecl();
+    }
+
+    //else the file is lexed and preprocessed a part at a time as the
+    //parser asks for declarations
+    beginFile(F);
+    CurrentPos = F->Contents;
+    DeclChunk = CurChunk;
+    DeclUsed = Used;
+    beginPreprocess();
+    return readDecl();
 }
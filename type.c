@@ -64,7 +64,7 @@ static void usualArithConv(Node** LHS, Node** RHS) {
 }
 
 Type* newType(TypeKind Kind, int Size, int Align) {
-    Type* Ty = calloc(1, sizeof(Type));
+    Type* Ty = arenaAlloc(&GlobalArena, sizeof(Type));
     Ty->typeKind = Kind;
     Ty->Size = Size;
     Ty->Align = Align;
@@ -77,51 +77,120 @@ bool isInteger(Type* TY) {
 }
 
 Type* copyType(Type* Ty) {
-    Type* Ret = calloc(1, sizeof(Type));
+    Type* Ret = arenaAlloc(&GlobalArena, sizeof(Type));
     *Ret = *Ty;
     return Ret;
 }
 
-Type* pointerTo(Type* Base) {
-    Type* Ty = newType(TypePTR, 8, 8);
+//pointer and array types are hash consed on (kind, base, length), one
+//table per thread as the lexer threads make the types of string literals
+static _Thread_local Type** Derived;
+static _Thread_local int DerivedCap;
+static _Thread_local int DerivedCnt;
+
+static uint32_t derivedHash(TypeKind Kind, Type* Base, int Len) {
+    return (uint32_t)(((uintptr_t)Base >> 4) * 31 + Len * 7 + Kind) * 2654435761u;
+}
+
+//Size and Align take part in the match, an array made before its struct
+//element was completed must not be handed out afterwards
+static Type** findDerived(TypeKind Kind, Type* Base, int Len, int Size, int Align) {
+    uint32_t I = derivedHash(Kind, Base, Len) & (DerivedCap - 1);
+    for(; Derived[I]; I = (I + 1) & (DerivedCap - 1)) {
+        Type* Ty = Derived[I];
+        if(Ty->typeKind == Kind && Ty->Base == Base && Ty->ArrayLen == Len &&
+           Ty->Size == Size && Ty->Align == Align)
+            break;
+    }
+    return &Derived[I];
+}
+
+static void rehashDerived(void) {
+    Type** Old = Derived;
+    int OldCap = DerivedCap;
+
+    DerivedCap = DerivedCap ? DerivedCap * 2 : 256;
+    Derived = calloc(DerivedCap, sizeof(Type*));
+    for(int I = 0; I < OldCap; ++I) {
+        Type* Ty = Old[I];
+        if(Ty)
+            *findDerived(Ty->typeKind, Ty->Base, Ty->ArrayLen, Ty->Size, Ty->Align) = Ty;
+    }
+    free(Old);
+}
+
+static Type* derivedType(TypeKind Kind, Type* Base, int Len, int Size, int Align) {
+    // keep the load factor under 1/2
+    if(DerivedCnt * 2 >= DerivedCap)
+        rehashDerived();
+
+    Type** Slot = findDerived(Kind, Base, Len, Size, Align);
+    if(*Slot)
+        return *Slot;
+
+    Type* Ty = newType(Kind, Size, Align);
     Ty->Base = Base;
+    Ty->ArrayLen = Len;
+    *Slot = Ty;
+    ++DerivedCnt;
     return Ty;
 }
 
+Type* pointerTo(Type* Base) {
+    return derivedType(TypePTR, Base, 0, 8, 8);
+}
+
 Type* funcType(Type* ReturnTy) {
-    Type* Ty = calloc(1, sizeof(Type));
+    Type* Ty = arenaAlloc(&GlobalArena, sizeof(Type));
     Ty->typeKind = TypeFunc;
     Ty->ReturnTy = ReturnTy;
     return Ty;
 }
 
 Type* arrayof(Type* Base, int Len) {
-    Type* Ty = newType(TypeARRAY, Base->Size * Len, Base->Align);
-    Ty->Base = Base;
-    Ty->ArrayLen = Len;
-
-    return Ty;
+    return derivedType(TypeARRAY, Base, Len, Base->Size * Len, Base->Align);
 }
 
+//times addType did the work for a node, never more than NodeCnt
+int64_t TypeVisits;
+
+//every node is typed once, a statement never gets a Ty so the flag is
+//what stops the enclosing expressions from walking it again
 void addType(Node* Nd) {
-    if(!Nd || Nd->Ty) {
+    if(!Nd || Nd->Ty || Nd->Typed) {
         return;
     }
+    Nd->Typed = true;
+    ++TypeVisits;
 
     addType(Nd->LHS);
     addType(Nd->RHS);
-    addType(Nd->Cond);
-    addType(Nd->Then);
-    addType(Nd->Els);
-    addType(Nd->Init);
-    addType(Nd->Inc);
-   
-    for(Node* Cur = Nd->Body; Cur; Cur = Cur->Next) {
-        addType(Cur);
-    }
 
-    for(Node* Cur = Nd->Args; Cur; Cur = Cur->Next) {
-        addType(Cur);
+    //children kept in the payload of the kind
+    switch(Nd->Kind) {
+        case ND_IF:
+        case ND_FOR:
+        case ND_COND:
+        case ND_SWITCH:
+            addType(Nd->Cond);
+            addType(Nd->Then);
+            addType(Nd->Els);
+            addType(Nd->Init);
+            addType(Nd->Inc);
+            break;
+        case ND_BLOCK:
+        case ND_STMT_EXPR:
+            for(Node* Cur = Nd->Body; Cur; Cur = Cur->Next) {
+                addType(Cur);
+            }
+            break;
+        case ND_FUNCALL:
+            for(Node* Cur = Nd->Args; Cur; Cur = Cur->Next) {
+                addType(Cur);
+            }
+            break;
+        default:
+            break;
     }
 
     switch(Nd->Kind) {